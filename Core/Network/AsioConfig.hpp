@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * @file AsioConfig.hpp
+ * @brief Selects the asio I/O backend for Core/Network and includes asio.
+ *
+ * Sockets run on the platform default reactor (IOCP on Windows, epoll on Linux) unless
+ * NETWORK_IO_URING is defined for the whole build, e.g. -DNETWORK_IO_URING together with
+ * linking liburing. Then, on Linux, every socket of Server, ClientSession and Client runs on
+ * io_uring, and batched session reads use registered buffers (see ReceiveArena). The
+ * setting is ignored on other platforms.
+ *
+ * The Visual Studio projects target Windows, where NETWORK_IO_URING has no effect. The
+ * io_uring code paths are compiled by the linux-io-uring workflow in .github/workflows,
+ * which builds Tools/NetBench with and without it.
+ *
+ * asio reads these macros when it is first included, so network code includes this header
+ * instead of <asio.hpp>, and every translation unit must be built with the same setting.
+ */
+
+#if defined(NETWORK_IO_URING) && defined(__linux__)
+#if defined(ASIO_VERSION) && !defined(ASIO_HAS_IO_URING)
+#error "asio was included before AsioConfig.hpp; include Core/Network headers first or define ASIO_HAS_IO_URING globally"
+#endif
+#ifndef ASIO_HAS_IO_URING
+#define ASIO_HAS_IO_URING 1
+#endif
+#ifndef ASIO_DISABLE_EPOLL
+#define ASIO_DISABLE_EPOLL 1
+#endif
+#define NETWORK_HAS_IO_URING 1
+#endif
+
+#include <asio.hpp>
+
+/**
+ * @brief Name of the backend that drives socket I/O in this build, for logs and benchmarks.
+ */
+constexpr const char* ioBackendName()
+{
+#if defined(NETWORK_HAS_IO_URING)
+	return "io_uring";
+#elif defined(_WIN32)
+	return "iocp";
+#elif defined(__linux__)
+	return "epoll";
+#else
+	return "reactor";
+#endif
+}
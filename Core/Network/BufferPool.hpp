@@ -0,0 +1,313 @@
+#pragma once
+
+/**
+ * @file BufferPool.hpp
+ * @brief Size-classed pool of refcounted byte buffers for the network hot path.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+
+class BufferPool;
+
+/**
+ * @class PooledBuffer
+ * @brief Intrusively refcounted handle to a block owned by a BufferPool.
+ *
+ * Copies share the block, moves transfer it without touching the refcount.
+ * When the last handle goes away the block returns to its pool's free list.
+ */
+class PooledBuffer
+{
+public:
+	PooledBuffer() = default;
+
+	PooledBuffer(const PooledBuffer& other) noexcept : block_(other.block_)
+	{
+		if(block_) block_->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	PooledBuffer(PooledBuffer&& other) noexcept : block_(std::exchange(other.block_, nullptr)) {}
+
+	PooledBuffer& operator=(const PooledBuffer& other) noexcept
+	{
+		if(this != &other)
+		{
+			PooledBuffer copy(other);
+			std::swap(block_, copy.block_);
+		}
+		return *this;
+	}
+
+	PooledBuffer& operator=(PooledBuffer&& other) noexcept
+	{
+		if(this != &other)
+		{
+			release();
+			block_ = std::exchange(other.block_, nullptr);
+		}
+		return *this;
+	}
+
+	~PooledBuffer() { release(); }
+
+	/**
+	 * @brief Writable pointer to the start of the block.
+	 */
+	uint8_t* data() const { return block_ ? block_->bytes() : nullptr; }
+
+	/**
+	 * @brief Usable size of the block in bytes.
+	 */
+	size_t capacity() const { return block_ ? block_->capacity : 0; }
+
+	/**
+	 * @brief True if this handle references a block.
+	 */
+	explicit operator bool() const { return block_ != nullptr; }
+
+	/**
+	 * @brief True if this is the only handle to its block, so writing to it cannot race a reader.
+	 */
+	bool unique() const { return block_ && block_->refs.load(std::memory_order_acquire) == 1; }
+
+	/**
+	 * @brief Drop this handle's reference, returning the block if it was the last one.
+	 */
+	inline void release();
+
+private:
+	friend class BufferPool;
+
+	/**
+	 * @struct Block
+	 * @brief Header placed in front of every pooled allocation.
+	 */
+	struct Block
+	{
+		std::atomic<uint32_t> refs{ 1 }; /**< Live handle count. */
+		uint32_t sizeClass = 0;          /**< Index into the pool's size classes, or npos for oversize. */
+		size_t capacity = 0;             /**< Usable bytes after the header. */
+		BufferPool* pool = nullptr;      /**< Owning pool. */
+
+		uint8_t* bytes() { return reinterpret_cast<uint8_t*>(this + 1); }
+	};
+
+	explicit PooledBuffer(Block* block) : block_(block) {}
+
+	Block* block_ = nullptr; /**< Referenced block, or nullptr. */
+};
+
+/**
+ * @class BufferSlice
+ * @brief Read-only window [offset, offset + size) into a PooledBuffer.
+ *
+ * Keeps the underlying block alive, so it can be queued and handed across threads
+ * without copying the bytes it refers to.
+ */
+class BufferSlice
+{
+public:
+	BufferSlice() = default;
+
+	/**
+	 * @brief Construct a slice over part of a buffer.
+	 * @param buffer Buffer to reference (moved in).
+	 * @param offset First byte of the slice.
+	 * @param size Number of bytes in the slice.
+	 */
+	BufferSlice(PooledBuffer buffer, size_t offset, size_t size)
+		: buffer_(std::move(buffer)), offset_(static_cast<uint32_t>(offset)), size_(static_cast<uint32_t>(size))
+	{
+	}
+
+	const uint8_t* data() const { return buffer_.data() + offset_; }
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
+	const uint8_t* begin() const { return data(); }
+	const uint8_t* end() const { return data() + size_; }
+
+	uint8_t operator[](size_t i) const { return data()[i]; }
+
+	/**
+	 * @brief View the slice as a span.
+	 */
+	std::span<const uint8_t> span() const { return { data(), size_ }; }
+	operator std::span<const uint8_t>() const { return span(); }
+
+	/**
+	 * @brief Narrow the slice to a sub-range, sharing the same block.
+	 * @param offset Offset relative to this slice.
+	 * @param size Number of bytes.
+	 */
+	BufferSlice subslice(size_t offset, size_t size) const
+	{
+		return BufferSlice(buffer_, offset_ + offset, size);
+	}
+
+	/**
+	 * @brief The underlying buffer.
+	 */
+	const PooledBuffer& buffer() const { return buffer_; }
+
+private:
+	PooledBuffer buffer_;  /**< Backing storage. */
+	uint32_t offset_ = 0;  /**< Start within the block. */
+	uint32_t size_ = 0;    /**< Length of the slice. */
+};
+
+/**
+ * @class BufferPool
+ * @brief Thread-safe free lists of fixed-size blocks, one per size class.
+ *
+ * acquire() picks the smallest class that fits; blocks are recycled instead of freed,
+ * so once the pool is warm a steady packet flow performs no heap allocations.
+ * Requests larger than the biggest class are served by a one-off allocation.
+ */
+class BufferPool
+{
+public:
+	/** Block sizes served from free lists: frames up to the maximum size plus cipher overhead, then default batched receive buffers. */
+	static constexpr std::array<size_t, 5> sizeClasses = { 256, 2 * 1024, 16 * 1024, 64 * 1024 + 256, 128 * 1024 + 256 };
+
+	BufferPool() = default;
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	~BufferPool()
+	{
+		for(auto& list : freeLists_)
+		{
+			for(auto* block : list.blocks)
+				freeBlock(block);
+		}
+	}
+
+	/**
+	 * @brief Process-wide pool used by sessions unless told otherwise.
+	 */
+	static BufferPool& shared()
+	{
+		static BufferPool pool;
+		return pool;
+	}
+
+	/**
+	 * @brief Get a buffer of at least size bytes.
+	 * @param size Required capacity.
+	 * @return Handle with refcount 1.
+	 */
+	PooledBuffer acquire(size_t size)
+	{
+		const size_t cls = classFor(size);
+		if(cls == npos)
+			return PooledBuffer(allocateBlock(size, npos));
+
+		auto& list = freeLists_[cls];
+		{
+			std::lock_guard<std::mutex> lock(list.mutex);
+			if(!list.blocks.empty())
+			{
+				auto* block = list.blocks.back();
+				list.blocks.pop_back();
+				block->refs.store(1, std::memory_order_relaxed);
+				return PooledBuffer(block);
+			}
+		}
+		return PooledBuffer(allocateBlock(sizeClasses[cls], cls));
+	}
+
+	/**
+	 * @brief Pre-populate a size class so startup traffic does not allocate.
+	 * @param size Any size served by the target class.
+	 * @param count Number of blocks to add.
+	 */
+	void reserve(size_t size, size_t count)
+	{
+		const size_t cls = classFor(size);
+		if(cls == npos) return;
+
+		auto& list = freeLists_[cls];
+		std::lock_guard<std::mutex> lock(list.mutex);
+		list.blocks.reserve(list.blocks.size() + count);
+		for(size_t i = 0; i < count; ++i)
+			list.blocks.push_back(allocateBlock(sizeClasses[cls], cls));
+	}
+
+	/**
+	 * @brief Largest size that is recycled rather than freed.
+	 */
+	static constexpr size_t maxPooledSize() { return sizeClasses.back(); }
+
+private:
+	friend class PooledBuffer;
+	using Block = PooledBuffer::Block;
+
+	static constexpr size_t npos = static_cast<size_t>(-1);
+
+	/**
+	 * @struct FreeList
+	 * @brief Recycled blocks of one size class.
+	 */
+	struct FreeList
+	{
+		std::mutex mutex;           /**< Guards blocks. */
+		std::vector<Block*> blocks; /**< Idle blocks ready for reuse. */
+	};
+
+	static size_t classFor(size_t size)
+	{
+		for(size_t i = 0; i < sizeClasses.size(); ++i)
+		{
+			if(size <= sizeClasses[i]) return i;
+		}
+		return npos;
+	}
+
+	Block* allocateBlock(size_t capacity, size_t cls)
+	{
+		void* memory = ::operator new(sizeof(Block) + capacity);
+		auto* block = new(memory) Block();
+		block->sizeClass = static_cast<uint32_t>(cls);
+		block->capacity = capacity;
+		block->pool = this;
+		return block;
+	}
+
+	static void freeBlock(Block* block)
+	{
+		block->~Block();
+		::operator delete(block);
+	}
+
+	void recycle(Block* block)
+	{
+		if(block->sizeClass == static_cast<uint32_t>(npos))
+		{
+			freeBlock(block);
+			return;
+		}
+
+		auto& list = freeLists_[block->sizeClass];
+		std::lock_guard<std::mutex> lock(list.mutex);
+		list.blocks.push_back(block);
+	}
+
+	std::array<FreeList, sizeClasses.size()> freeLists_; /**< One free list per size class. */
+};
+
+inline void PooledBuffer::release()
+{
+	if(!block_) return;
+	if(block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		block_->pool->recycle(block_);
+	block_ = nullptr;
+}
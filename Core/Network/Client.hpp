@@ -5,162 +5,331 @@
  * @brief Client connection class supporting Flatbuffers and hard packets.
  */
 
-#include <asio.hpp>
+#include "AsioConfig.hpp"
 #include <iostream>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <span>
+#include <string>
+#include "MpscQueue.hpp"
 #include "Packet.hpp"
+#include "FrameHeader.hpp"
 #include "Crypto.hpp"
 #include "PacketDispatcher.hpp"
+#include "HardPacketRegistry.hpp"
 #include "Opcodes.hpp"
-//#include "MMO_generated.h"
+#include "SocketOptions.hpp"
 
 using asio::ip::tcp;
 
 /**
  * @class Client
  * @brief Represents a client connection to the server.
+ *
+ * Must be owned by a std::shared_ptr: connect() and every pending operation keep the
+ * client alive through shared_from_this().
+ *
+ * @code
+ * auto client = std::make_shared<Client>(ioContext, crypto, dispatcher);
+ * client->connect("127.0.0.1", 7777);
+ * @endcode
  */
 class Client : public std::enable_shared_from_this<Client>
 {
 public:
 	/**
-	 * @brief Constructor to connect and start reading.
+	 * @brief Callback for connect(); receives the connect error, if any.
+	 */
+	using ConnectHandler = std::function<void(std::error_code)>;
+
+	/**
+	 * @brief Constructor; does not touch the network until connect().
 	 * @param ioContext asio context.
-	 * @param host Server hostname.
-	 * @param port Server port.
-	 * @param crypto AES crypto helper.
-	 * @param dispatcher Packet dispatcher for incoming packets.
+	 * @param crypto Crypto helper; its CipherMode must match the server's.
+	 * @param dispatcher Packet dispatcher for incoming packets; must outlive the client.
+	 * @param socketOptions TCP tuning applied once connected.
 	 */
 	Client(asio::io_context& ioContext,
-		   const std::string& host,
-		   uint16_t port,
 		   Crypto crypto,
-		   PacketDispatcher<Client>& dispatcher)
-		: socket_(ioContext), crypto_(crypto), dispatcher_(dispatcher)
+		   PacketDispatcher<Client>& dispatcher,
+		   const SocketOptions& socketOptions = {})
+		: socket_(ioContext), strand_(asio::make_strand(ioContext)), crypto_(crypto), dispatcher_(dispatcher),
+		socketOptions_(socketOptions)
+	{
+		crypto_.setServerSide(false);
+	}
+
+	/**
+	 * @brief Resolve host and connect asynchronously, then start reading.
+	 * @param host Server hostname.
+	 * @param port Server port.
+	 * @param onConnect Called on the client's strand once connected or failed.
+	 */
+	void connect(const std::string& host, uint16_t port, ConnectHandler onConnect = {})
+	{
+		tcp::resolver resolver(socket_.get_executor());
+		connect(resolver.resolve(host, std::to_string(port)), std::move(onConnect));
+	}
+
+	/**
+	 * @brief Connect asynchronously to already resolved endpoints, then start reading.
+	 * @param endpoints Candidates, tried in order.
+	 * @param onConnect Called on the client's strand once connected or failed.
+	 */
+	void connect(const tcp::resolver::results_type& endpoints, ConnectHandler onConnect = {})
 	{
-		tcp::resolver resolver(ioContext);
-		auto endpoints = resolver.resolve(host, std::to_string(port));
 		asio::async_connect(socket_, endpoints,
-							[this, self = shared_from_this()](std::error_code ec, tcp::endpoint)
+							asio::bind_executor(strand_, [this, self = shared_from_this(), onConnect = std::move(onConnect)](std::error_code ec, tcp::endpoint)
 							{
+								if(!ec && !crypto_.beginSession(localSalt_))
+									ec = std::make_error_code(std::errc::protocol_error);
 								if(!ec)
 								{
-									readHeader();
+									socketOptions_.apply(socket_);
+									connected_ = true;
+									// The salt leads the first write, even if nothing was sent yet
+									helloPending_ = true;
+									if(!writing_.exchange(true)) writeNext();
+									readPeerSalt();
+								}
+								else if(socket_.is_open())
+								{
+									close();
 								}
-								else
+								if(ec && !onConnect)
 								{
 									std::cerr << "Connect failed: " << ec.message() << "\n";
 								}
-							});
+								if(onConnect) onConnect(ec);
+							}));
+	}
+
+	/**
+	 * @brief True between a successful connect and the first socket error or disconnect().
+	 */
+	bool connected() const { return connected_; }
+
+	/**
+	 * @brief Closes the connection from any thread.
+	 */
+	void disconnect()
+	{
+		asio::post(strand_, [this, self = shared_from_this()]() { close(); });
 	}
 
 	/**
-	 * @brief Send a packet (Flatbuffers or hard).
+	 * @brief Send a packet (Flatbuffers or hard); callable from any thread.
+	 *
+	 * Pushes into a lock-free queue; only an idle writer is woken on the strand.
+	 * Packets sent before the connect completes stay queued and go out right
+	 * after the salt, once the session is keyed.
+	 *
 	 * @param packet Packet buffer.
 	 */
-	void sendPacket(const Packet& packet)
+	void sendPacket(Packet packet)
 	{
-		bool writing = !writeQueue_.size();
-		writeQueue_.push(packet);
-		if(!writing) return;
-		writeNext();
+		writeQueue_.push(std::move(packet));
+		// The connect handler drains the queue; no key exists before it runs
+		if(!connected_) return;
+		if(!writing_.exchange(true))
+			asio::post(strand_, [this, self = shared_from_this()]() { writeNext(); });
 	}
 
 private:
+	/**
+	 * @brief Closes the socket. Runs on the strand.
+	 */
+	void close()
+	{
+		connected_ = false;
+		asio::error_code ignored;
+		socket_.close(ignored);
+	}
+
+	/**
+	 * @brief Reads the server's salt, which precedes its first frame, and keys decryption with it.
+	 */
+	void readPeerSalt()
+	{
+		asio::async_read(socket_,
+						 asio::buffer(peerSalt_),
+						 asio::bind_executor(strand_, [this, self = shared_from_this()](std::error_code ec, std::size_t)
+						 {
+							 if(ec || !crypto_.acceptPeerSalt(peerSalt_))
+							 {
+								 close();
+								 return;
+							 }
+							 readHeader();
+						 }));
+	}
+
 	void readHeader()
 	{
 		asio::async_read(socket_,
-						 asio::buffer(&incomingLength_, sizeof(incomingLength_)),
-						 [this, self = shared_from_this()](std::error_code ec, std::size_t)
+						 asio::buffer(&incomingHeader_, sizeof(incomingHeader_)),
+						 asio::bind_executor(strand_, [this, self = shared_from_this()](std::error_code ec, std::size_t)
 						 {
 							 if(!ec)
 							 {
-								 if(incomingLength_ > maxPacketSize)
+								 if(!incomingHeader_.isSupported(maxPacketSize, FrameFlags::Flatbuffers | FrameFlags::Fragment | FrameFlags::FinalFragment))
 								 {
-									 socket_.close();
+									 close();
 									 return;
 								 }
-								 incomingEncrypted_.resize(incomingLength_);
+								 incomingEncrypted_.resize(incomingHeader_.length);
 								 readBody();
 							 }
 							 else
 							 {
-								 socket_.close();
+								 close();
 							 }
-						 });
+						 }));
 	}
 
 	void readBody()
 	{
 		asio::async_read(socket_,
 						 asio::buffer(incomingEncrypted_),
-						 [this, self = shared_from_this()](std::error_code ec, std::size_t)
+						 asio::bind_executor(strand_, [this, self = shared_from_this()](std::error_code ec, std::size_t)
 						 {
 							 if(!ec)
 							 {
-								 auto decrypted = crypto_.decrypt(incomingEncrypted_);
-
-								 if(isFlatbuffers(decrypted))
+								 socketOptions_.rearmQuickAck(socket_);
+								 // Decrypt in place; the header is the AEAD associated data
+								 size_t decryptedSize = 0;
+								 const auto aad = std::span(reinterpret_cast<const uint8_t*>(&incomingHeader_), sizeof(incomingHeader_));
+								 if(!crypto_.decrypt(incomingEncrypted_.data(), incomingEncrypted_.size(),
+													 incomingEncrypted_.data(), decryptedSize, aad))
 								 {
-									 const MMO::Packet* fbPacket = MMO::GetPacket(decrypted.data());
-									 dispatcher_.dispatch(shared_from_this(), fbPacket->opcode(), decrypted);
+									 close();
+									 return;
 								 }
-								 else
+
+								 std::span<const uint8_t> decrypted(incomingEncrypted_.data(), decryptedSize);
+								 if(incomingHeader_.isFragment())
 								 {
-									 if(decrypted.size() >= sizeof(HardMovePacket))
+									 if(!appendFragment(decrypted))
 									 {
-										 HardMovePacket p;
-										 std::memcpy(&p, decrypted.data(), sizeof(HardMovePacket));
-										 dispatcher_.dispatch(shared_from_this(), p.opcode, decrypted);
+										 close();
+										 return;
 									 }
+									 if(!incomingHeader_.isFinalFragment())
+									 {
+										 readHeader();
+										 return;
+									 }
+									 decrypted = incomingMessage_;
 								 }
+
+								 if(incomingHeader_.isFlatbuffers() || HardPackets::validate(incomingHeader_.opcode, decrypted))
+									 dispatcher_.dispatch(*this, incomingHeader_.opcode, decrypted);
+								 if(incomingHeader_.isFinalFragment()) incomingMessage_.clear();
+
 								 readHeader();
 							 }
 							 else
 							 {
-								 socket_.close();
+								 close();
 							 }
-						 });
+						 }));
+	}
+
+	/**
+	 * @brief Adds a chunk to the bulk message being reassembled. Runs on the strand.
+	 *
+	 * A session sends one bulk message at a time, so all chunks until the final one share
+	 * an opcode; whole frames arriving between them are dispatched as usual.
+	 *
+	 * @return False on a protocol violation: an opcode change mid-message or a message over maxMessageSize.
+	 */
+	bool appendFragment(std::span<const uint8_t> chunk)
+	{
+		if(!incomingMessage_.empty() && incomingHeader_.opcode != messageOpcode_) return false;
+		if(incomingMessage_.size() + chunk.size() > maxMessageSize) return false;
+		messageOpcode_ = incomingHeader_.opcode;
+		incomingMessage_.insert(incomingMessage_.end(), chunk.begin(), chunk.end());
+		return true;
 	}
 
 	void writeNext()
 	{
+		if(!connected_)
+		{
+			writing_ = false;
+			return;
+		}
+
+		finalWriteBuffer_.clear();
+		if(helloPending_)
+		{
+			finalWriteBuffer_.assign(localSalt_.begin(), localSalt_.end());
+			helloPending_ = false;
+		}
+
 		Packet packet;
-		if(!writeQueue_.pop(packet)) return;
+		if(writeQueue_.pop(packet))
+		{
+			const auto& body = packet.body();
+			const size_t encryptedSize = crypto_.maxEncryptedSize(body.size());
+			const auto header = FrameHeader::make(packet.opcode(), packet.flags(), static_cast<uint32_t>(encryptedSize));
 
-		auto encrypted = crypto_.encrypt(packet.body());
-		uint32_t len = static_cast<uint32_t>(encrypted.size());
+			// Encrypt straight into the frame after the header
+			const size_t frameStart = finalWriteBuffer_.size();
+			finalWriteBuffer_.resize(frameStart + sizeof(header) + encryptedSize);
+			std::memcpy(finalWriteBuffer_.data() + frameStart, &header, sizeof(header));
 
-		finalWriteBuffer_.resize(sizeof(len) + encrypted.size());
-		std::memcpy(finalWriteBuffer_.data(), &len, sizeof(len));
-		std::memcpy(finalWriteBuffer_.data() + sizeof(len), encrypted.data(), encrypted.size());
+			size_t written = 0;
+			if(!crypto_.encrypt(body.data(), body.size(), finalWriteBuffer_.data() + frameStart + sizeof(header), written,
+								std::span(finalWriteBuffer_.data() + frameStart, sizeof(header))))
+			{
+				writing_ = false;
+				close();
+				return;
+			}
+			finalWriteBuffer_.resize(frameStart + sizeof(header) + written);
+		}
+		else if(finalWriteBuffer_.empty())
+		{
+			writing_.store(false);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(!writeQueue_.empty() && !writing_.exchange(true)) writeNext();
+			return;
+		}
 
 		asio::async_write(socket_, asio::buffer(finalWriteBuffer_),
-						  [this, self = shared_from_this()](std::error_code ec, std::size_t)
+						  asio::bind_executor(strand_, [this, self = shared_from_this()](std::error_code ec, std::size_t)
 						  {
 							  if(!ec) writeNext();
-							  else socket_.close();
-						  });
-	}
-
-	bool isFlatbuffers(const std::vector<uint8_t>& data)
-	{
-		if(data.size() < sizeof(uint16_t)) return false;
-		uint16_t opcode = 0;
-		std::memcpy(&opcode, data.data(), sizeof(uint16_t));
-		return opcode < 1000;
+							  else
+							  {
+								  writing_ = false;
+								  close();
+							  }
+						  }));
 	}
 
 private:
 	tcp::socket socket_;                    /**< The TCP socket. */
-	Crypto crypto_;                        /**< AES crypto helper. */
+	asio::strand<asio::io_context::executor_type> strand_; /**< Serializes all socket work. */
+	Crypto crypto_;                        /**< Session keys and cipher (CBC, GCM or ChaCha20-Poly1305). */
+	Crypto::Salt localSalt_{};             /**< Salt keying this client's sends; sent ahead of the first frame. */
+	Crypto::Salt peerSalt_{};              /**< Salt keying the server's sends, read before its first frame. */
+	bool helloPending_ = false;            /**< localSalt_ not yet put in a write, strand only. */
 	PacketDispatcher<Client>& dispatcher_; /**< Dispatcher for incoming packets. */
+	SocketOptions socketOptions_;          /**< TCP tuning applied on connect. */
 
-	uint32_t incomingLength_ = 0;           /**< Incoming packet length. */
-	std::vector<uint8_t> incomingEncrypted_; /**< Buffer for encrypted data. */
+	FrameHeader incomingHeader_{};          /**< Header of the frame being read. */
+	std::vector<uint8_t> incomingEncrypted_; /**< Buffer for encrypted data, decrypted in place. */
+	std::vector<uint8_t> incomingMessage_;   /**< Chunks of the bulk message being reassembled. */
+	uint16_t messageOpcode_ = NONE;          /**< Opcode of that message. */
 	std::vector<uint8_t> finalWriteBuffer_;   /**< Buffer for encrypted outgoing data. */
 
-	ThreadSafeQueue<Packet> writeQueue_;   /**< Outgoing packet queue. */
+	MpscQueue<Packet> writeQueue_;         /**< Outgoing packet queue, drained by the strand. */
+	std::atomic<bool> writing_{ false };   /**< True while a write chain is running. */
+	std::atomic<bool> connected_{ false }; /**< Connection is up. */
 
 	static constexpr uint32_t maxPacketSize = 64 * 1024; /**< Max packet size. */
+	static constexpr size_t maxMessageSize = 16 * 1024 * 1024; /**< Max size of a reassembled bulk message. */
 };
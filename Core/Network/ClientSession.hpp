@@ -2,21 +2,37 @@
 
 /**
  * @file ClientSession.hpp
- * @brief Handles a TCP session with AES encryption, receiving Flatbuffers and hard packets.
+ * @brief Handles an encrypted TCP session, receiving Flatbuffers and hard packets.
  */
 
-#include <asio.hpp>
+#include "AsioConfig.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <unordered_map>
 #include <iostream>
 #include <vector>
 #include <cstring>
+#include <span>
 
+#include "BufferPool.hpp"
 #include "Packet.hpp"
+#include "ReceiveBuffer.hpp"
+#include "SessionOptions.hpp"
 #include "Crypto.hpp"
 #include "ThreadSafeQueue.hpp"
+#include "FrameHeader.hpp"
 #include "GameEvent.hpp"
+#include "HardPacketRegistry.hpp"
+#include "InboundRateLimiter.hpp"
+#include "SessionRegistry.hpp"
+#include "MpscQueue.hpp"
+#include "NetworkMetrics.hpp"
 #include "Opcodes.hpp"
-//#include "MMO_generated.h"
+#include "PacketCapture.hpp"
+#include "PacketTrace.hpp"
 
 using asio::ip::tcp;
 
@@ -24,7 +40,8 @@ using asio::ip::tcp;
  * @class ClientSession
  * @brief Represents a connected client session.
  *
- * Supports receiving and sending both Flatbuffers and hard packets, encrypted with AES.
+ * Supports receiving and sending both Flatbuffers and hard packets, encrypted with the
+ * Crypto's CipherMode (AES-256-CBC, AES-256-GCM or ChaCha20-Poly1305).
  * Incoming packets are pushed as GameEvents to a thread-safe queue.
  */
 class ClientSession : public std::enable_shared_from_this<ClientSession>
@@ -33,165 +50,817 @@ public:
 	/**
 	 * @brief Constructs the session.
 	 * @param socket TCP socket from acceptor.
-	 * @param crypto AES encryption helper.
+	 * @param crypto Encryption helper (CBC or AEAD), owned by this session.
 	 * @param eventQueue Queue to push incoming events for ECS.
+	 * @param options Per-session I/O configuration.
+	 * @param receiveArena Arena of the socket's io_context to lease the receive buffer from, or nullptr for the shared BufferPool.
 	 */
 	ClientSession(tcp::socket socket,
 				  Crypto crypto,
-				  ThreadSafeQueue<GameEvent>& eventQueue)
+				  ThreadSafeQueue<GameEvent>& eventQueue,
+				  const SessionOptions& options = {},
+				  ReceiveArena* receiveArena = nullptr)
 		: socket_(std::move(socket)),
 		crypto_(crypto),
-		eventQueue_(eventQueue)
+		eventQueue_(eventQueue),
+		strand_(asio::make_strand(socket_.get_executor())),
+		handshakeTimer_(strand_),
+		budgetTimer_(strand_),
+		options_(options),
+		receiveBuffer_(makeReceiveBuffer(options, receiveArena)),
+		inboundLimiter_(options.inboundLimits, maxPacketSize)
 	{
+		crypto_.setServerSide(true);
+		// Keyed before the session is shared, so no write can precede the salt
+		sessionKeyed_ = crypto_.beginSession(localSalt_);
+	}
+
+	/**
+	 * @brief Receive buffer capacity a session uses in ReadMode::Batched; always room for a FrameHeader.
+	 *
+	 * Frames that do not fit are finished in a pooled buffer of their own, so the capacity
+	 * only needs to cover the small frames that make up most traffic.
+	 */
+	static size_t receiveBufferSize(const SessionOptions& options)
+	{
+		return std::max(options.receiveBufferSize, sizeof(FrameHeader));
 	}
 
 	  /**
-	   * @brief Starts the async read loop.
+	   * @brief Sends this session's salt and starts the async read loop with the client's.
 	   */
-	void start() { readHeader(); }
+	void start()
+	{
+		asio::dispatch(strand_, [this, self = shared_from_this()]()
+					   {
+						   if(!sessionKeyed_)
+						   {
+							   close();
+							   return;
+						   }
+						   armHandshakeTimer();
+						   if(!writing_.exchange(true)) writeNext();
+						   readPeerSalt();
+					   });
+	}
+
+	/**
+	 * @brief Registers the session so GameEvent handles resolve to it; call before start().
+	 * @param registry Registry that keeps the session alive until it closes.
+	 */
+	void registerIn(SessionRegistry& registry)
+	{
+		registry_ = &registry;
+		handle_ = registry.add(shared_from_this());
+	}
 
 	/**
-	 * @brief Asynchronously sends a packet to the client.
+	 * @brief Counts the session in a pending-handshake counter until its first valid frame or close; call before start().
+	 * @param pendingHandshakes Counter already incremented for this session; decremented exactly once.
+	 */
+	void trackHandshake(std::atomic<size_t>& pendingHandshakes)
+	{
+		pendingHandshakes_ = &pendingHandshakes;
+	}
+
+	/**
+	 * @brief Handle carried by this session's GameEvents.
+	 */
+	SessionHandle handle() const { return handle_; }
+
+	/**
+	 * @brief Closes the connection from any thread.
+	 */
+	void disconnect()
+	{
+		asio::post(strand_, [this, self = shared_from_this()]() { close(); });
+	}
+
+	/**
+	 * @brief Queues a packet for the client; callable from any thread.
+	 *
+	 * The packet goes into a lock-free MPSC queue. Only the first send after the writer
+	 * goes idle posts a flush to the session's strand, so a burst of sends costs one
+	 * atomic exchange each. Packets from one thread are written in the order sent.
+	 *
+	 * While the session is over its outbound budget (SessionOptions::maxPendingBytes /
+	 * maxPendingPackets) droppable packets are discarded; if it stays over budget for
+	 * SessionOptions::overBudgetGrace it is disconnected, whether or not more is sent.
+	 *
 	 * @param packet Packet containing raw payload (already serialized).
 	 */
-	void sendPacket(const Packet& packet)
+	void sendPacket(Packet packet)
 	{
-		bool writing = !writeQueue_.size();
-		writeQueue_.push(packet);
-		if(!writing) return;
-		writeNext();
+		const size_t size = packet.body().size();
+		if(pendingBytes_.load(std::memory_order_relaxed) + size > options_.maxPendingBytes
+		   || pendingPackets_.load(std::memory_order_relaxed) + 1 > options_.maxPendingPackets)
+		{
+			noteOverBudget();
+			if(packet.droppable())
+			{
+				NetworkMetrics::bump(metrics_.packetsDropped);
+				return;
+			}
+		}
+
+		packet.setTraceStamp(trace_.sampleStamp());
+		pendingBytes_.fetch_add(size, std::memory_order_relaxed);
+		pendingPackets_.fetch_add(1, std::memory_order_relaxed);
+		writeQueue_.push(std::move(packet));
+		if(!writing_.exchange(true))
+			asio::post(strand_, [this, self = shared_from_this()]() { writeNext(); });
 	}
 
 private:
 	/**
-	 * @brief Reads the 4-byte incoming packet length header.
+	 * @brief Builds the batched-read buffer, preferring a slot of the context's ReceiveArena.
+	 */
+	static ReceiveBuffer makeReceiveBuffer(const SessionOptions& options, ReceiveArena* arena)
+	{
+		if(options.readMode != ReadMode::Batched) return ReceiveBuffer(0);
+		const size_t capacity = receiveBufferSize(options);
+		return arena ? ReceiveBuffer(capacity, *arena) : ReceiveBuffer(capacity);
+	}
+
+	/**
+	 * @brief Records that the session is over budget and disconnects it once the grace period has passed.
+	 *
+	 * Callable from any thread; overBudgetSince_ is reset by the strand once the backlog drains.
+	 * Going over budget arms budgetTimer_, so a session that is sent nothing more is still
+	 * disconnected on time.
+	 */
+	void noteOverBudget()
+	{
+		const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+		auto since = decltype(now){ 0 };
+		if(overBudgetSince_.compare_exchange_strong(since, now))
+		{
+			NetworkMetrics::bump(metrics_.overBudgetEntered);
+			asio::post(strand_, [this, self = shared_from_this()]() { armBudgetTimer(options_.overBudgetGrace); });
+			return;
+		}
+		expireOverBudget(now, since);
+	}
+
+	/**
+	 * @brief Disconnects the session if it has been over budget for the whole grace period.
+	 * @param now Current steady_clock ticks.
+	 * @param since Ticks when the session went over budget.
+	 * @return True if the grace period has passed.
+	 */
+	bool expireOverBudget(std::chrono::steady_clock::rep now, std::chrono::steady_clock::rep since)
+	{
+		const auto grace = std::chrono::duration_cast<std::chrono::steady_clock::duration>(options_.overBudgetGrace).count();
+		if(now - since < grace) return false;
+		if(!slowDisconnect_.exchange(true))
+		{
+			NetworkMetrics::bump(metrics_.slowDisconnects);
+			disconnect();
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Checks the outbound budget again after a delay. Runs on the strand.
+	 */
+	void armBudgetTimer(std::chrono::steady_clock::duration delay)
+	{
+		if(closed_) return;
+
+		budgetTimer_.expires_after(delay);
+		budgetTimer_.async_wait([this, self = shared_from_this()](std::error_code ec)
+								{
+									const auto since = overBudgetSince_.load();
+									if(ec || closed_ || since == 0) return;
+
+									// Went back within budget and over again meanwhile: wait out the rest of the new grace period
+									const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+									if(!expireOverBudget(now, since))
+										armBudgetTimer(options_.overBudgetGrace - std::chrono::steady_clock::duration(now - since));
+								});
+	}
+
+	/**
+	 * @brief Gives a packet's bytes back to the outbound budget once it leaves the pending state.
+	 */
+	void releaseBudget(const Packet& packet)
+	{
+		pendingBytes_.fetch_sub(packet.body().size(), std::memory_order_relaxed);
+		pendingPackets_.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Identity under which droppable packets replace each other.
+	 */
+	static uint64_t coalesceId(const Packet& packet)
+	{
+		return (static_cast<uint64_t>(packet.opcode()) << 32) | packet.coalesceKey();
+	}
+
+	/**
+	 * @brief Outbound lane of a packet, resolving PacketLane::Auto by payload size.
+	 */
+	PacketLane laneOf(const Packet& packet) const
+	{
+		if(packet.lane() != PacketLane::Auto) return packet.lane();
+		return packet.body().size() > options_.bulkThreshold ? PacketLane::Bulk : PacketLane::Critical;
+	}
+
+	/**
+	 * @brief Moves everything from the MPSC queue to pending_ and bulkPending_, coalescing droppable packets. Runs on the strand.
+	 *
+	 * A droppable critical packet whose opcode and key match one still pending overwrites
+	 * it in place, so the newest state goes out in the slot of the oldest. Bulk packets are
+	 * never coalesced.
+	 */
+	void drainWriteQueue()
+	{
+		Packet packet;
+		while(writeQueue_.pop(packet))
+		{
+			if(laneOf(packet) == PacketLane::Bulk)
+			{
+				bulkPending_.push_back(std::move(packet));
+				continue;
+			}
+
+			if(packet.droppable())
+			{
+				auto [it, inserted] = coalesceIndex_.try_emplace(coalesceId(packet), pendingBase_ + pending_.size());
+				if(!inserted)
+				{
+					Packet& stale = pending_[it->second - pendingBase_];
+					releaseBudget(stale);
+					stale = std::move(packet);
+					NetworkMetrics::bump(metrics_.packetsCoalesced);
+					continue;
+				}
+			}
+			pending_.push_back(std::move(packet));
+		}
+
+		if(pendingBytes_.load(std::memory_order_relaxed) > options_.maxPendingBytes
+		   || pendingPackets_.load(std::memory_order_relaxed) > options_.maxPendingPackets)
+			noteOverBudget();
+		else
+			overBudgetSince_.store(0);
+	}
+
+	/**
+	 * @brief Removes the oldest pending packet. Runs on the strand.
+	 */
+	Packet takePending()
+	{
+		Packet packet = std::move(pending_.front());
+		pending_.pop_front();
+
+		if(packet.droppable())
+		{
+			auto it = coalesceIndex_.find(coalesceId(packet));
+			if(it != coalesceIndex_.end() && it->second == pendingBase_) coalesceIndex_.erase(it);
+		}
+		++pendingBase_;
+		releaseBudget(packet);
+		return packet;
+	}
+
+	/**
+	 * @brief Closes the session if no valid frame arrives within SessionOptions::handshakeTimeout. Runs on the strand.
+	 */
+	void armHandshakeTimer()
+	{
+		if(options_.handshakeTimeout.count() <= 0) return;
+
+		handshakeTimer_.expires_after(options_.handshakeTimeout);
+		handshakeTimer_.async_wait([this, self = shared_from_this()](std::error_code ec)
+								   {
+									   if(ec || !handshakePending_) return;
+									   NetworkMetrics::bump(metrics_.handshakeTimeouts);
+									   close();
+								   });
+	}
+
+	/**
+	 * @brief Leaves the pending-handshake state once. Runs on the strand.
+	 */
+	void completeHandshake()
+	{
+		if(!handshakePending_) return;
+		handshakePending_ = false;
+		if(pendingHandshakes_) pendingHandshakes_->fetch_sub(1, std::memory_order_relaxed);
+		handshakeTimer_.cancel();
+	}
+
+	/**
+	 * @brief Closes the socket once, leaves the registry and tells the game loop. Runs on the strand.
+	 *
+	 * A session that queued any event queues SESSION_CLOSED after its last one, so the game
+	 * loop sees it last and can drop whatever state it keeps per session.
+	 */
+	void close()
+	{
+		if(closed_) return;
+		closed_ = true;
+
+		const bool queuedEvents = !handshakePending_;
+		completeHandshake();
+		budgetTimer_.cancel();
+		asio::error_code ignored;
+		socket_.close(ignored);
+		if(!registry_) return;
+		registry_->remove(handle_);
+		if(!queuedEvents) return;
+		// Captured too, so a replayed game loop frees the session's state like the live one
+		if(options_.capture) options_.capture->record(handle_, SESSION_CLOSED, FrameFlags::None, {});
+		eventQueue_.push(GameEvent{ SESSION_CLOSED, handle_, BufferSlice(), PacketTimestamps() });
+	}
+
+	/**
+	 * @brief Reads the client's salt, which precedes its first frame, and keys decryption with it.
+	 */
+	void readPeerSalt()
+	{
+		auto self = shared_from_this();
+		asio::async_read(socket_,
+						 asio::buffer(peerSalt_),
+						 asio::bind_executor(strand_, [this, self](std::error_code ec, std::size_t)
+						 {
+							 if(ec || !crypto_.acceptPeerSalt(peerSalt_))
+							 {
+								 close();
+								 return;
+							 }
+
+							 readFrames();
+						 }));
+	}
+
+	/**
+	 * @brief Continues with the next frame in the configured ReadMode.
+	 */
+	void readFrames()
+	{
+		if(options_.readMode == ReadMode::Batched) readSome();
+		else readHeader();
+	}
+
+	/**
+	 * @brief Reads the 8-byte FrameHeader of the next frame.
 	 */
 	void readHeader()
 	{
 		auto self = shared_from_this();
 		asio::async_read(socket_,
-						 asio::buffer(&incomingLength_, sizeof(incomingLength_)),
-						 [this, self](std::error_code ec, std::size_t)
+						 asio::buffer(&incomingHeader_, sizeof(incomingHeader_)),
+						 asio::bind_executor(strand_, [this, self](std::error_code ec, std::size_t)
 						 {
 							 if(!ec)
 							 {
-								 if(incomingLength_ > maxPacketSize)
+								 if(!incomingHeader_.isSupported(maxPacketSize))
 								 {
-// Invalid size, close connection
-									 socket_.close();
+// Invalid size, version or flags, close connection
+									 close();
 									 return;
 								 }
-								 incomingEncrypted_.resize(incomingLength_);
+
+								 // Rate-limited before the body is even read; a skipped body is read but never decrypted
+								 const FrameAdmission admission = admitFrame(incomingHeader_);
+								 if(admission == FrameAdmission::Close)
+								 {
+									 close();
+									 return;
+								 }
+								 skipBody_ = admission == FrameAdmission::Skip;
+								 incomingBuffer_ = bufferPool_.acquire(incomingHeader_.length);
 								 readBody();
 							 }
 							 else
 							 {
-								 socket_.close();
+								 close();
 							 }
-						 });
+						 }));
 	}
 
 	/**
-	 * @brief Reads the encrypted body based on length header.
+	 * @brief Reads the rest of the encrypted body into the pooled buffer and decrypts it in place.
+	 *
+	 * Used for every frame in ReadMode::PerFrame, and in ReadMode::Batched for frames larger
+	 * than the receive buffer; the first incomingFilled_ bytes are already in place.
 	 */
 	void readBody()
 	{
 		auto self = shared_from_this();
 		asio::async_read(socket_,
-						 asio::buffer(incomingEncrypted_),
-						 [this, self](std::error_code ec, std::size_t)
+						 asio::buffer(incomingBuffer_.data() + incomingFilled_, incomingHeader_.length - incomingFilled_),
+						 asio::bind_executor(strand_, [this, self](std::error_code ec, std::size_t)
 						 {
 							 if(!ec)
 							 {
-								 auto decrypted = crypto_.decrypt(incomingEncrypted_);
-
-								 // Detect if Flatbuffers or hard packet
-								 if(isFlatbuffers(decrypted))
+								 readStamp_ = traceCountdown_ == 0 ? trace_.stamp() : 0;
+								 options_.socketOptions.rearmQuickAck(socket_);
+								 incomingFilled_ = 0;
+								 if(skipBody_)
 								 {
-	  // Flatbuffers packet
-									 const MMO::Packet* fbPacket = MMO::GetPacket(decrypted.data());
-									 auto opcode = static_cast<Opcode>(fbPacket->opcode());
-									 eventQueue_.push(GameEvent{ opcode, std::vector<uint8_t>(decrypted), shared_from_this() });
+									 incomingBuffer_ = PooledBuffer();
+									 readFrames();
+									 return;
 								 }
-								 else
+
+								 const uint8_t* encrypted = incomingBuffer_.data();
+								 if(!onFrame(incomingHeader_, encrypted, std::move(incomingBuffer_)))
 								 {
-												  // Hard packet
-									 if(decrypted.size() >= sizeof(HardMovePacket))
-									 {
-										 HardMovePacket p;
-										 std::memcpy(&p, decrypted.data(), sizeof(HardMovePacket));
-										 eventQueue_.push(GameEvent{ static_cast<Opcode>(p.opcode), decrypted, shared_from_this() });
-									 }
-									 else
-									 {
-										 std::cerr << "Received malformed hard packet.\n";
-									 }
+									 close();
+									 return;
 								 }
 
-								 readHeader();
+								 readFrames();
 							 }
 							 else
 							 {
-								 socket_.close();
+								 close();
 							 }
-						 });
+						 }));
+	}
+
+	/**
+	 * @brief Reads whatever is available into the receive buffer and handles every complete frame.
+	 */
+	void readSome()
+	{
+		auto handler = asio::bind_executor(strand_, [this, self = shared_from_this()](std::error_code ec, std::size_t bytes)
+										   {
+											   if(ec)
+											   {
+												   close();
+												   return;
+											   }
+
+											   readStamp_ = traceCountdown_ == 0 ? trace_.stamp() : 0;
+											   receiveBuffer_.commit(bytes);
+											   options_.socketOptions.rearmQuickAck(socket_);
+											   if(!parseFrames())
+											   {
+												   close();
+												   return;
+											   }
+											   if(largeFrame_)
+											   {
+												   largeFrame_ = false;
+												   readBody();
+												   return;
+											   }
+
+											   receiveBuffer_.compact();
+											   readSome();
+										   });
+
+#if defined(NETWORK_HAS_IO_URING)
+		// Slot registered with the ring: the read is submitted as IORING_OP_READ_FIXED
+		if(receiveBuffer_.registered())
+		{
+			socket_.async_read_some(receiveBuffer_.registeredWritable(), std::move(handler));
+			return;
+		}
+#endif
+		socket_.async_read_some(asio::buffer(receiveBuffer_.writePtr(), receiveBuffer_.writableSize()), std::move(handler));
+	}
+
+	/**
+	 * @brief Consumes every complete [FrameHeader][payload] frame from the receive buffer.
+	 *
+	 * Stops at a frame larger than the whole buffer after moving it out with
+	 * beginLargeFrame(); the caller then finishes it with readBody().
+	 *
+	 * @return False if a frame was invalid and the session must close.
+	 */
+	bool parseFrames()
+	{
+		FrameHeader header;
+		while(receiveBuffer_.readableSize() >= sizeof(header))
+		{
+			std::memcpy(&header, receiveBuffer_.readPtr(), sizeof(header));
+			if(!header.isSupported(maxPacketSize)) return false;
+			if(receiveBuffer_.readableSize() < sizeof(header) + header.length)
+			{
+				if(sizeof(header) + header.length > receiveBuffer_.capacity()) return beginLargeFrame(header);
+				break;
+			}
+
+			const FrameAdmission admission = admitFrame(header);
+			if(admission == FrameAdmission::Close) return false;
+			if(admission == FrameAdmission::Skip)
+			{
+				receiveBuffer_.consume(sizeof(header) + header.length);
+				continue;
+			}
+
+			const uint8_t* encrypted = receiveBuffer_.readPtr() + sizeof(header);
+			if(!onFrame(header, encrypted, bufferPool_.acquire(header.length))) return false;
+
+			receiveBuffer_.consume(sizeof(header) + header.length);
+		}
+		return true;
 	}
 
 	/**
-	 * @brief Sends next packet from the write queue.
+	 * @brief Moves the received start of a frame that cannot fit the receive buffer into a pooled buffer of its own.
+	 *
+	 * Sets largeFrame_ so the read loop finishes the frame with readBody(), as in
+	 * ReadMode::PerFrame. The frame is admitted here, from its header, like any other.
+	 *
+	 * @param header Validated header at the head of the receive buffer.
+	 * @return False if the rate limiter closes the session.
+	 */
+	bool beginLargeFrame(const FrameHeader& header)
+	{
+		const FrameAdmission admission = admitFrame(header);
+		if(admission == FrameAdmission::Close) return false;
+		skipBody_ = admission == FrameAdmission::Skip;
+
+		receiveBuffer_.consume(sizeof(header));
+		incomingHeader_ = header;
+		incomingBuffer_ = bufferPool_.acquire(header.length);
+		incomingFilled_ = receiveBuffer_.readableSize();
+		std::memcpy(incomingBuffer_.data(), receiveBuffer_.readPtr(), incomingFilled_);
+		receiveBuffer_.consume(incomingFilled_);
+		largeFrame_ = true;
+		return true;
+	}
+
+	/**
+	 * @brief Checks a frame against the inbound rate limits before any decrypt work.
+	 *
+	 * Skipped and closing frames are counted, with the decrypt time they would have cost
+	 * estimated from this session's sampled decrypt timings.
+	 */
+	FrameAdmission admitFrame(const FrameHeader& header)
+	{
+		if(!inboundLimiter_.enabled()) return FrameAdmission::Accept;
+
+		const FrameAdmission admission = inboundLimiter_.admit(header);
+		if(admission == FrameAdmission::Accept) return admission;
+
+		crypto_.skipIncoming();
+		NetworkMetrics::bump(metrics_.framesRateLimited);
+		NetworkMetrics::bump(metrics_.bytesNotDecrypted, header.length);
+		NetworkMetrics::bump(metrics_.decryptNanosSaved, inboundLimiter_.decryptNanos(header.length));
+		if(admission == FrameAdmission::Close) NetworkMetrics::bump(metrics_.rateLimitDisconnects);
+		return admission;
+	}
+
+	/**
+	 * @brief Decrypts one frame into a pooled buffer and queues it as a GameEvent.
+	 *
+	 * Opcode and payload kind come from the cleartext header, so the payload is never
+	 * inspected to route it; hard packets are only size-checked against the registry.
+	 *
+	 * @param header Validated frame header, authenticated as AEAD associated data.
+	 * @param encrypted Encrypted payload; may point into buffer for in-place decryption.
+	 * @param buffer Pooled destination of at least header.length bytes, handed to the event.
+	 * @return False if decryption failed or the frame carries a local-only opcode.
+	 */
+	bool onFrame(const FrameHeader& header, const uint8_t* encrypted, PooledBuffer buffer)
+	{
+		size_t decryptedSize = 0;
+		const auto aad = std::span(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+
+		// With rate limiting on, some decrypts are timed so skipped frames can be priced
+		const bool timed = inboundLimiter_.sampleDecrypt();
+		const auto decryptStart = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+		if(!crypto_.decrypt(encrypted, header.length, buffer.data(), decryptedSize, aad))
+			return false;
+		if(timed)
+			inboundLimiter_.recordDecrypt(header.length, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - decryptStart));
+
+		// Only a read that started with the countdown at zero is stamped; later frames of it wait for the next one
+		const bool traced = trace_.sample(traceCountdown_) && readStamp_;
+		const uint64_t decryptedAt = traced ? TraceClock::now() : 0;
+
+		// Reserved for the event close() queues; a client sending it is misbehaving
+		if(header.opcode == SESSION_CLOSED) return false;
+
+		BufferSlice decrypted(std::move(buffer), 0, decryptedSize);
+
+		// Hard packets must match their registered size and repeat the header opcode
+		if(!header.isFlatbuffers() && !HardPackets::validate(header.opcode, decrypted))
+		{
+			std::cerr << "Received malformed hard packet.\n";
+			return true;
+		}
+
+		if(options_.capture) options_.capture->record(handle_, header.opcode, header.frameFlags(), decrypted.span());
+
+		PacketTimestamps timestamps;
+		if(traced) timestamps = { readStamp_, decryptedAt, TraceClock::now() };
+		eventQueue_.push(GameEvent{ static_cast<Opcode>(header.opcode), handle_, std::move(decrypted), timestamps });
+		completeHandshake();
+		return true;
+	}
+
+	/**
+	 * @brief Encrypts one payload into a pooled [header][encrypted payload] frame and adds it to the write in flight.
+	 *
+	 * A whole pooled payload serialized with headroom (see FlatBufferPool) becomes the frame
+	 * in place; chunks and every other payload are encrypted into a fresh pooled buffer.
+	 *
+	 * @param packet Packet the payload belongs to.
+	 * @param payload The whole body, or one chunk of it.
+	 * @param flags Frame flags, including fragment bits for chunks.
+	 * @return Frame bytes added, 0 if encryption failed; the send counter has then moved on, so the session must close.
+	 */
+	size_t appendFrame(const Packet& packet, std::span<const uint8_t> payload, FrameFlags flags)
+	{
+		const size_t encryptedSize = crypto_.maxEncryptedSize(payload.size());
+		const auto header = FrameHeader::make(packet.opcode(), flags, static_cast<uint32_t>(encryptedSize));
+
+		PooledBuffer frame;
+		uint8_t* frameStart = nullptr;
+		const PooledBuffer* buffer = payload.size() == packet.body().size() ? packet.frameInPlace(sizeof(header), Crypto::maxOverhead) : nullptr;
+		if(buffer)
+		{
+			frame = *buffer;
+			frameStart = const_cast<uint8_t*>(payload.data()) - sizeof(header);
+		}
+		else
+		{
+			frame = bufferPool_.acquire(sizeof(header) + encryptedSize);
+			frameStart = frame.data();
+		}
+		std::memcpy(frameStart, &header, sizeof(header));
+
+		size_t written = 0;
+		if(!crypto_.encrypt(payload.data(), payload.size(), frameStart + sizeof(header), written,
+							std::span(frameStart, sizeof(header))))
+			return 0;
+
+		outgoingBuffers_.push_back(asio::buffer(frameStart, sizeof(header) + written));
+		outgoingFrames_.push_back(std::move(frame));
+		return sizeof(header) + written;
+	}
+
+	/**
+	 * @brief Adds the next chunk of the oldest bulk packet to the write in flight. Runs on the strand.
+	 *
+	 * A payload of at most one chunk goes out as a plain frame; a larger one as Fragment
+	 * frames, the last also flagged FinalFragment. The packet keeps its outbound budget
+	 * until its last chunk is written.
+	 *
+	 * @return Frame bytes added, 0 if encryption failed and the session must close.
+	 */
+	size_t appendBulkChunk()
+	{
+		const Packet& packet = bulkPending_.front();
+		const auto body = packet.body();
+		const size_t chunkSize = std::clamp<size_t>(options_.bulkChunkSize, 1, maxPacketSize - Crypto::maxOverhead);
+		const size_t size = std::min(chunkSize, body.size() - bulkOffset_);
+		const bool whole = bulkOffset_ == 0 && size == body.size();
+		const bool last = bulkOffset_ + size == body.size();
+
+		FrameFlags flags = packet.flags();
+		if(!whole) flags |= last ? FrameFlags::Fragment | FrameFlags::FinalFragment : FrameFlags::Fragment;
+		const size_t written = appendFrame(packet, body.subspan(bulkOffset_, size), flags);
+		bulkOffset_ += size;
+
+		if(last && written)
+		{
+			if(packet.traceStamp()) outgoingTraces_.emplace_back(packet.opcode(), packet.traceStamp());
+			releaseBudget(packet);
+			bulkPending_.pop_front();
+			bulkOffset_ = 0;
+		}
+		return written;
+	}
+
+	/**
+	 * @brief Drains the write queue into one gathered write. Runs on the strand.
+	 *
+	 * Every pending critical packet is encrypted directly into its own pooled frame until
+	 * SessionOptions::maxBytesPerFlush is reached, then one chunk of the oldest bulk packet
+	 * is added. The frames go out as a single buffer sequence so the socket sees one writev
+	 * instead of one write per packet. Since a write carries at most one bulk chunk,
+	 * a critical packet queued behind a large payload waits for one chunk, not all of it.
+	 * The first write of the session also carries its salt, ahead of every frame.
 	 */
 	void writeNext()
 	{
-		Packet packet;
-		if(!writeQueue_.pop(packet)) return;
+		drainWriteQueue();
+		outgoingFrames_.clear();
+		outgoingBuffers_.clear();
+		outgoingTraces_.clear();
+
+		// The salt goes out once, in front of the first frame
+		if(helloPending_)
+		{
+			outgoingBuffers_.push_back(asio::buffer(localSalt_));
+			helloPending_ = false;
+		}
 
-		auto encrypted = crypto_.encrypt(packet.body());
-		uint32_t len = static_cast<uint32_t>(encrypted.size());
+		size_t flushBytes = 0;
+		while(flushBytes < options_.maxBytesPerFlush && !pending_.empty())
+		{
+			const Packet packet = takePending();
+			const size_t written = appendFrame(packet, packet.body(), packet.flags());
+			if(!written)
+			{
+				failWrite();
+				return;
+			}
 
-		// Compose full message: [length][encrypted payload]
-		finalWriteBuffer_.resize(sizeof(len) + encrypted.size());
-		std::memcpy(finalWriteBuffer_.data(), &len, sizeof(len));
-		std::memcpy(finalWriteBuffer_.data() + sizeof(len), encrypted.data(), encrypted.size());
+			flushBytes += written;
+			if(packet.traceStamp()) outgoingTraces_.emplace_back(packet.opcode(), packet.traceStamp());
+		}
+		if(flushBytes < options_.maxBytesPerFlush && !bulkPending_.empty() && !appendBulkChunk())
+		{
+			failWrite();
+			return;
+		}
+
+		if(outgoingBuffers_.empty())
+		{
+			writing_.store(false);
+			// A packet pushed between the failed pop and the reset would otherwise sit unsent
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(!writeQueue_.empty() && !writing_.exchange(true)) writeNext();
+			return;
+		}
 
 		auto self = shared_from_this();
-		asio::async_write(socket_, asio::buffer(finalWriteBuffer_),
-						  [this, self](std::error_code ec, std::size_t)
+		asio::async_write(socket_, outgoingBuffers_,
+						  asio::bind_executor(strand_, [this, self](std::error_code ec, std::size_t)
 						  {
 							  if(!ec)
 							  {
+								  const uint64_t writtenAt = outgoingTraces_.empty() ? 0 : trace_.stamp();
+								  for(const auto& [opcode, sentAt] : outgoingTraces_)
+									  trace_.record(opcode, TraceStage::Reply, sentAt, writtenAt);
 								  writeNext();
 							  }
 							  else
 							  {
-								  socket_.close();
+								  failWrite();
 							  }
-						  });
+						  }));
 	}
 
 	/**
-	 * @brief Heuristic to determine if decrypted data is Flatbuffers.
-	 * @param data Decrypted packet bytes.
-	 * @return True if data is Flatbuffers packet, false otherwise.
+	 * @brief Ends the write chain and closes the session. Runs on the strand.
+	 *
+	 * Used for socket errors and for encrypt failures alike: a frame that failed to encrypt
+	 * has already consumed a nonce, or is part of a bulk message whose earlier fragments
+	 * were sent, so the stream cannot continue without it.
 	 */
-	bool isFlatbuffers(const std::vector<uint8_t>& data)
+	void failWrite()
 	{
-		if(data.size() < sizeof(uint16_t)) return false;
-		uint16_t opcode = 0;
-		std::memcpy(&opcode, data.data(), sizeof(uint16_t));
-		// Flatbuffers opcode is defined as < 1000, e.g. 0 for FB packets.
-		return opcode < 1000;
+		writing_ = false;
+		close();
 	}
 
 private:
 	tcp::socket socket_;                    /**< The TCP socket */
-	Crypto crypto_;                        /**< AES encrypt/decrypt */
+	Crypto crypto_;                        /**< Session keys and cipher (CBC, GCM or ChaCha20-Poly1305) */
+	Crypto::Salt localSalt_{};             /**< Salt keying this session's sends; sent ahead of the first frame */
+	Crypto::Salt peerSalt_{};              /**< Salt keying the client's sends, read before its first frame */
+	bool sessionKeyed_ = false;            /**< localSalt_ was drawn and the send key derived */
+	bool helloPending_ = true;             /**< localSalt_ not yet put in a write, strand only */
 	ThreadSafeQueue<GameEvent>& eventQueue_; /**< Queue for game loop */
+	asio::strand<tcp::socket::executor_type> strand_; /**< Serializes all socket work */
+	asio::steady_timer handshakeTimer_;    /**< Fires SessionOptions::handshakeTimeout after start() */
+	asio::steady_timer budgetTimer_;       /**< Fires SessionOptions::overBudgetGrace after the session goes over budget */
+
+	SessionOptions options_;               /**< I/O configuration */
+	SessionRegistry* registry_ = nullptr;  /**< Owning registry, if registered */
+	SessionHandle handle_;                 /**< Identity in registry_ */
+	bool closed_ = false;                  /**< Set by close(), strand only */
+	bool handshakePending_ = true;         /**< No valid frame received yet, strand only */
+	std::atomic<size_t>* pendingHandshakes_ = nullptr; /**< Server's pending-handshake counter, if tracked */
+	ReceiveBuffer receiveBuffer_;          /**< Batched read buffer (ReadMode::Batched only) */
 
-	uint32_t incomingLength_ = 0;          /**< Length of next encrypted packet */
-	std::vector<uint8_t> incomingEncrypted_; /**< Buffer for encrypted incoming data */
-	std::vector<uint8_t> finalWriteBuffer_;   /**< Buffer for encrypted outgoing data */
+	FrameHeader incomingHeader_{};         /**< Header of the frame being read by readBody() */
+	BufferPool& bufferPool_ = BufferPool::shared(); /**< Source of receive buffers */
+	PooledBuffer incomingBuffer_;          /**< Encrypted frame, decrypted in place */
+	size_t incomingFilled_ = 0;            /**< Bytes of incomingBuffer_ already received */
+	bool largeFrame_ = false;              /**< parseFrames() left a frame larger than receiveBuffer_ for readBody() */
+	std::vector<PooledBuffer> outgoingFrames_;       /**< Encrypted frames of the write in flight */
+	std::vector<asio::const_buffer> outgoingBuffers_; /**< Gather list over outgoingFrames_ */
+	std::vector<std::pair<uint16_t, uint64_t>> outgoingTraces_; /**< Opcode and send stamp of traced packets in the write in flight */
+	std::atomic<bool> writing_{ false };   /**< True while a write chain is running */
 
-	ThreadSafeQueue<Packet> writeQueue_;   /**< Queue for outgoing packets */
+	MpscQueue<Packet> writeQueue_;         /**< Outgoing packets, drained by the strand */
+	std::deque<Packet> pending_;           /**< Drained critical packets not yet written, strand only */
+	std::deque<Packet> bulkPending_;       /**< Drained bulk packets not yet fully written, strand only */
+	size_t bulkOffset_ = 0;                /**< Bytes of bulkPending_.front() already written, strand only */
+	uint64_t pendingBase_ = 0;             /**< Sequence number of pending_.front() */
+	std::unordered_map<uint64_t, uint64_t> coalesceIndex_; /**< coalesceId -> sequence of the pending droppable packet */
+	std::atomic<size_t> pendingBytes_{ 0 };   /**< Payload bytes in writeQueue_, pending_ and bulkPending_ */
+	std::atomic<size_t> pendingPackets_{ 0 }; /**< Packets in writeQueue_, pending_ and bulkPending_ */
+	std::atomic<std::chrono::steady_clock::rep> overBudgetSince_{ 0 }; /**< When the session went over budget, 0 if within */
+	std::atomic<bool> slowDisconnect_{ false }; /**< Set once a slow-consumer disconnect was issued */
+	NetworkMetrics& metrics_ = NetworkMetrics::shared(); /**< Policy counters */
+	PacketTrace& trace_ = PacketTrace::shared(); /**< Stage timestamps and histograms, if enabled */
+	uint64_t readStamp_ = 0;               /**< TraceClock ticks of the last read completion, strand only */
+	uint32_t traceCountdown_ = 0;          /**< Received frames until the next traced one, strand only */
+	InboundRateLimiter inboundLimiter_;    /**< Inbound rate limits, strand only */
+	bool skipBody_ = false;                /**< Body being read by readBody() belongs to a rate-limited frame */
 
 	static constexpr uint32_t maxPacketSize = 64 * 1024; /**< Max allowed packet size */
 };
@@ -2,79 +2,454 @@
 
 /**
  * @file Crypto.hpp
- * @brief AES-256-CBC encrypt/decrypt helper.
+ * @brief Packet encrypt/decrypt helper (AES-256-CBC or AEAD).
  */
 
 #include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <span>
+#include <string_view>
 #include <vector>
 #include <cstdint>
+#include <cstring>
+
+/**
+ * @enum CipherMode
+ * @brief Packet cipher used by a Crypto instance. Both peers must agree on it.
+ */
+enum class CipherMode
+{
+	Aes256Cbc,       /**< AES-256-CBC with PKCS#7 padding and a fixed IV; no integrity check. */
+	Aes256Gcm,       /**< AES-256-GCM, 16-byte tag, counter-derived nonces. */
+	ChaCha20Poly1305 /**< ChaCha20-Poly1305, 16-byte tag, counter-derived nonces. */
+};
+
+/**
+ * @brief Parse a cipher name as given on the command line: cbc, gcm or chacha.
+ * @param name Cipher name.
+ * @param mode Set to the matching mode; untouched if the name is unknown.
+ * @return False if the name is unknown.
+ */
+inline bool parseCipher(std::string_view name, CipherMode& mode)
+{
+	if(name == "cbc") mode = CipherMode::Aes256Cbc;
+	else if(name == "gcm") mode = CipherMode::Aes256Gcm;
+	else if(name == "chacha") mode = CipherMode::ChaCha20Poly1305;
+	else return false;
+	return true;
+}
 
 /**
  * @class Crypto
- * @brief Provides AES-256-CBC encryption and decryption for packet payloads.
+ * @brief Provides encryption and decryption for packet payloads.
+ *
+ * The key and IV given to the constructor are a long-lived secret shared by every
+ * connection and never encrypt traffic themselves. Each connection opens with both peers
+ * sending a random salt of saltSize bytes in the clear (see beginSession()). A direction's
+ * key and IV are derived with HKDF-SHA256 from the shared secret and the salt of the peer
+ * sending in that direction, so every connection, and each direction of it, encrypts under
+ * its own key, and the sender alone picks the randomness that keeps it unique.
+ *
+ * Each direction keeps one keyed context for the whole connection; each packet only
+ * resets the IV, so the key schedule is computed once. An instance is therefore not safe
+ * to use from two threads at once. Copies get their own contexts and no session keys,
+ * which is how every session ends up with a private Crypto.
+ *
+ * In the AEAD modes each frame is [ciphertext][16-byte tag] with no padding. The 12-byte
+ * nonce is never sent: it is the first 12 bytes of the direction's IV XOR its packet
+ * counter, with the top bit of the first byte flipped for server-to-client traffic so a
+ * peer reflecting our own salt back still never shares a nonce with us. TCP delivers
+ * frames in order, so both peers derive the same sequence; a dropped, replayed or
+ * tampered frame fails tag verification.
  */
 class Crypto
 {
 public:
+	static constexpr size_t blockSize = 16; /**< AES block size. */
+	static constexpr size_t tagSize = 16;   /**< AEAD authentication tag size. */
+	static constexpr size_t nonceSize = 12; /**< AEAD nonce size. */
+	static constexpr size_t maxOverhead = 16; /**< Most bytes maxEncryptedSize() adds to a payload in any mode. */
+	static constexpr size_t saltSize = 16;  /**< Per-connection salt each peer sends before its first frame. */
+
+	using Salt = std::array<uint8_t, saltSize>;
+
 	/**
-	 * @brief Constructor with key and IV.
+	 * @brief Constructor with the shared secret key and IV; call beginSession() and acceptPeerSalt() before any traffic.
 	 * @param key 32 bytes (256-bit).
-	 * @param iv 16 bytes (128-bit).
+	 * @param iv 16 bytes (128-bit), mixed into the derivation of every session key.
+	 * @param mode Cipher to use.
+	 */
+	Crypto(const std::vector<uint8_t>& key, const std::vector<uint8_t>& iv, CipherMode mode = CipherMode::Aes256Cbc)
+		: key_(key), iv_(iv), mode_(mode),
+		encryptCtx_(EVP_CIPHER_CTX_new()),
+		decryptCtx_(EVP_CIPHER_CTX_new())
+	{
+	}
+
+	/**
+	 * @brief Copies the shared secret and mode into fresh cipher contexts; session keys are not copied.
+	 */
+	Crypto(const Crypto& other) : Crypto(other.key_, other.iv_, other.mode_)
+	{
+		serverSide_ = other.serverSide_;
+	}
+
+	Crypto& operator=(const Crypto& other)
+	{
+		if(this != &other)
+		{
+			Crypto copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+
+	Crypto(Crypto&&) noexcept = default;
+	Crypto& operator=(Crypto&&) noexcept = default;
+
+	/**
+	 * @brief Derive key and IV from a shared secret string with SHA-256.
+	 *
+	 * Meant for development servers and tools that need matching keys without a key
+	 * exchange: key = SHA-256(secret), IV = first 16 bytes of SHA-256(key).
+	 *
+	 * @param secret Secret known to both peers.
+	 * @param mode Cipher to use.
+	 */
+	static Crypto fromSecret(std::string_view secret, CipherMode mode = CipherMode::Aes256Cbc)
+	{
+		std::vector<uint8_t> key(32), digest(32);
+		EVP_Digest(secret.data(), secret.size(), key.data(), nullptr, EVP_sha256(), nullptr);
+		EVP_Digest(key.data(), key.size(), digest.data(), nullptr, EVP_sha256(), nullptr);
+		return Crypto(key, std::vector<uint8_t>(digest.begin(), digest.begin() + 16), mode);
+	}
+
+	/**
+	 * @brief Selects the nonce direction; call once per connection before any traffic.
+	 * @param serverSide True on the server's end of the connection.
 	 */
-	Crypto(const std::vector<uint8_t>& key, const std::vector<uint8_t>& iv)
-		: key_(key), iv_(iv)
+	void setServerSide(bool serverSide) { serverSide_ = serverSide; }
+
+	/**
+	 * @brief Draw a fresh salt and key the sending direction with it.
+	 *
+	 * The salt must reach the peer before the first frame, which it passes to
+	 * acceptPeerSalt(). Until this succeeds, encrypt() fails.
+	 *
+	 * @param salt Receives the salt to send.
+	 * @return False if no random bytes or key could be produced.
+	 */
+	bool beginSession(Salt& salt)
+	{
+		sendCounter_ = 0;
+		sendReady_ = RAND_bytes(salt.data(), static_cast<int>(salt.size())) == 1
+			&& deriveSessionKey(salt, serverSide_, encryptCtx_.get(), sendIv_, true);
+		return sendReady_;
+	}
+
+	/**
+	 * @brief Key the receiving direction with the salt the peer sent.
+	 *
+	 * A wrong or forged salt is not detected here: it yields a key under which the peer's
+	 * frames fail to decrypt.
+	 *
+	 * @return False if no key could be produced.
+	 */
+	bool acceptPeerSalt(const Salt& salt)
+	{
+		recvCounter_ = 0;
+		recvReady_ = deriveSessionKey(salt, !serverSide_, decryptCtx_.get(), recvIv_, false);
+		return recvReady_;
+	}
+
+	/**
+	 * @brief The cipher this instance uses.
+	 */
+	CipherMode mode() const { return mode_; }
+
+	/**
+	 * @brief True for the authenticated modes.
+	 */
+	bool isAead() const { return mode_ != CipherMode::Aes256Cbc; }
+
+	/**
+	 * @brief Ciphertext size for a given plaintext size.
+	 *
+	 * Exact in every mode (PKCS#7 always pads to the next block), so a frame header
+	 * carrying the length can be written before encrypting.
+	 *
+	 * @param size Plain bytes.
+	 * @return Bytes the output buffer of encrypt() must hold.
+	 */
+	size_t maxEncryptedSize(size_t size) const
 	{
+		return isAead() ? size + tagSize : (size / blockSize + 1) * blockSize;
 	}
 
 	  /**
-	   * @brief Encrypt raw data with AES-256-CBC.
+	   * @brief Encrypt raw data.
 	   * @param data Plain bytes.
 	   * @return Encrypted bytes.
 	   */
 	std::vector<uint8_t> encrypt(const std::vector<uint8_t>& data)
 	{
-		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-		std::vector<uint8_t> ciphertext(data.size() + EVP_MAX_BLOCK_LENGTH);
+		std::vector<uint8_t> ciphertext(maxEncryptedSize(data.size()));
+		size_t ciphertext_len = 0;
+		if(!encrypt(data.data(), data.size(), ciphertext.data(), ciphertext_len))
+			ciphertext_len = 0;
 
-		int len;
-		int ciphertext_len;
+		ciphertext.resize(ciphertext_len);
+		return ciphertext;
+	}
 
-		EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key_.data(), iv_.data());
-		EVP_EncryptUpdate(ctx, ciphertext.data(), &len, data.data(), data.size());
+	/**
+	 * @brief Encrypt raw data into a caller-provided buffer.
+	 *
+	 * Lets the writer place ciphertext directly after the length prefix of an outgoing frame.
+	 *
+	 * @param in Plain bytes.
+	 * @param size Number of plain bytes.
+	 * @param out Destination; must hold maxEncryptedSize(size) bytes.
+	 * @param outSize Receives the number of encrypted bytes written.
+	 * @param aad Associated data authenticated with the payload in the AEAD modes (e.g. the frame header).
+	 * @return False if OpenSSL reported an error.
+	 */
+	bool encrypt(const uint8_t* in, size_t size, uint8_t* out, size_t& outSize, std::span<const uint8_t> aad = {})
+	{
+		outSize = 0;
+		if(!sendReady_) return false;
+		if(isAead()) return sealAead(in, size, out, outSize, aad);
+
+		EVP_CIPHER_CTX* ctx = encryptCtx_.get();
+
+		int len = 0;
+		int ciphertext_len = 0;
+
+		bool ok = EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, sendIv_.data()) == 1
+			&& EVP_EncryptUpdate(ctx, out, &len, in, static_cast<int>(size)) == 1;
 		ciphertext_len = len;
-		EVP_EncryptFinal_ex(ctx, ciphertext.data() + len, &len);
+		ok = ok && EVP_EncryptFinal_ex(ctx, out + len, &len) == 1;
 		ciphertext_len += len;
 
-		EVP_CIPHER_CTX_free(ctx);
-		ciphertext.resize(ciphertext_len);
-		return ciphertext;
+		outSize = ok ? static_cast<size_t>(ciphertext_len) : 0;
+		return ok;
 	}
 
 	/**
-	 * @brief Decrypt AES-256-CBC encrypted data.
+	 * @brief Decrypt encrypted data.
 	 * @param ciphertext Encrypted bytes.
 	 * @return Decrypted plain bytes.
 	 */
 	std::vector<uint8_t> decrypt(const std::vector<uint8_t>& ciphertext)
 	{
-		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
 		std::vector<uint8_t> plaintext(ciphertext.size());
+		size_t plaintext_len = 0;
+		if(!decrypt(ciphertext.data(), ciphertext.size(), plaintext.data(), plaintext_len))
+			plaintext_len = 0;
 
-		int len;
-		int plaintext_len;
+		plaintext.resize(plaintext_len);
+		return plaintext;
+	}
+
+	/**
+	 * @brief Decrypt data into a caller-provided buffer.
+	 *
+	 * out may equal in for in-place decryption; out must hold at least size bytes.
+	 * In the AEAD modes the tag is verified before true is returned, so a tampered
+	 * frame never reaches any decoding.
+	 *
+	 * @param in Encrypted bytes.
+	 * @param size Number of encrypted bytes.
+	 * @param out Destination for plain bytes.
+	 * @param outSize Receives the number of plain bytes written.
+	 * @param aad Associated data that must match what the sender authenticated (AEAD modes only).
+	 * @return False if the ciphertext, its padding or its tag is invalid.
+	 */
+	bool decrypt(const uint8_t* in, size_t size, uint8_t* out, size_t& outSize, std::span<const uint8_t> aad = {})
+	{
+		outSize = 0;
+		if(!recvReady_) return false;
+		if(isAead()) return openAead(in, size, out, outSize, aad);
+
+		EVP_CIPHER_CTX* ctx = decryptCtx_.get();
 
-		EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key_.data(), iv_.data());
-		EVP_DecryptUpdate(ctx, plaintext.data(), &len, ciphertext.data(), ciphertext.size());
+		int len = 0;
+		int plaintext_len = 0;
+
+		bool ok = EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, recvIv_.data()) == 1
+			&& EVP_DecryptUpdate(ctx, out, &len, in, static_cast<int>(size)) == 1;
 		plaintext_len = len;
-		EVP_DecryptFinal_ex(ctx, plaintext.data() + len, &len);
+		ok = ok && EVP_DecryptFinal_ex(ctx, out + len, &len) == 1;
 		plaintext_len += len;
 
-		EVP_CIPHER_CTX_free(ctx);
-		plaintext.resize(plaintext_len);
-		return plaintext;
+		outSize = ok ? static_cast<size_t>(plaintext_len) : 0;
+		return ok;
+	}
+
+	/**
+	 * @brief Account for an incoming frame that is dropped without being decrypted.
+	 *
+	 * The AEAD modes derive each nonce from the frame's position in the stream, so the
+	 * receive counter must still advance or every later frame fails verification. CBC
+	 * frames are independent and need nothing.
+	 */
+	void skipIncoming()
+	{
+		if(isAead()) ++recvCounter_;
 	}
 
 private:
-	std::vector<uint8_t> key_; /**< AES key (32 bytes). */
-	std::vector<uint8_t> iv_;  /**< AES IV (16 bytes). */
+	/**
+	 * @brief EVP cipher for the configured mode.
+	 */
+	const EVP_CIPHER* cipher() const
+	{
+		switch(mode_)
+		{
+			case CipherMode::Aes256Gcm: return EVP_aes_256_gcm();
+			case CipherMode::ChaCha20Poly1305: return EVP_chacha20_poly1305();
+			default: return EVP_aes_256_cbc();
+		}
+	}
+
+	/**
+	 * @brief Derive the key and IV of one direction with HKDF-SHA256 and key its context.
+	 *
+	 * The input key is the shared key, the salt is the sending peer's and the info is
+	 * [shared IV][direction byte]. The first 32 output bytes are the key, the next 16 the IV.
+	 *
+	 * @param salt Salt of the peer sending in this direction.
+	 * @param fromServer Direction the key protects.
+	 * @param ctx Context to key.
+	 * @param iv Receives the direction's IV.
+	 * @param forEncrypt True to key ctx for encryption.
+	 */
+	bool deriveSessionKey(const Salt& salt, bool fromServer, EVP_CIPHER_CTX* ctx, std::array<uint8_t, blockSize>& iv, bool forEncrypt) const
+	{
+		std::vector<uint8_t> info(iv_);
+		info.push_back(fromServer ? 's' : 'c');
+
+		std::array<uint8_t, 32 + blockSize> okm{};
+		size_t okmSize = okm.size();
+		std::unique_ptr<EVP_PKEY_CTX, PkeyCtxDeleter> kdf(EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr));
+		const bool derived = kdf
+			&& EVP_PKEY_derive_init(kdf.get()) == 1
+			&& EVP_PKEY_CTX_set_hkdf_md(kdf.get(), EVP_sha256()) == 1
+			&& EVP_PKEY_CTX_set1_hkdf_salt(kdf.get(), salt.data(), static_cast<int>(salt.size())) == 1
+			&& EVP_PKEY_CTX_set1_hkdf_key(kdf.get(), key_.data(), static_cast<int>(key_.size())) == 1
+			&& EVP_PKEY_CTX_add1_hkdf_info(kdf.get(), info.data(), static_cast<int>(info.size())) == 1
+			&& EVP_PKEY_derive(kdf.get(), okm.data(), &okmSize) == 1
+			&& okmSize == okm.size();
+		if(!derived) return false;
+
+		std::memcpy(iv.data(), okm.data() + 32, iv.size());
+		const bool keyed = forEncrypt
+			? EVP_EncryptInit_ex(ctx, cipher(), nullptr, okm.data(), isAead() ? nullptr : iv.data()) == 1
+			: EVP_DecryptInit_ex(ctx, cipher(), nullptr, okm.data(), isAead() ? nullptr : iv.data()) == 1;
+		OPENSSL_cleanse(okm.data(), okm.size());
+		return keyed;
+	}
+
+	/**
+	 * @brief Derive the nonce for the next packet in one direction and advance its counter.
+	 * @param iv IV of that direction.
+	 * @param fromServer Direction of the packet.
+	 * @param counter Packet counter for that direction.
+	 */
+	static std::array<uint8_t, nonceSize> nextNonce(const std::array<uint8_t, blockSize>& iv, bool fromServer, uint64_t& counter)
+	{
+		std::array<uint8_t, nonceSize> nonce{};
+		std::memcpy(nonce.data(), iv.data(), nonce.size());
+
+		const uint64_t sequence = counter++;
+		for(size_t i = 0; i < sizeof(sequence); ++i)
+			nonce[nonceSize - 1 - i] ^= static_cast<uint8_t>(sequence >> (8 * i));
+		if(fromServer) nonce[0] ^= 0x80;
+		return nonce;
+	}
+
+	/**
+	 * @brief AEAD encrypt: writes ciphertext followed by the tag.
+	 */
+	bool sealAead(const uint8_t* in, size_t size, uint8_t* out, size_t& outSize, std::span<const uint8_t> aad)
+	{
+		EVP_CIPHER_CTX* ctx = encryptCtx_.get();
+		const auto nonce = nextNonce(sendIv_, serverSide_, sendCounter_);
+
+		int len = 0;
+		int finalLen = 0;
+		bool ok = EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, nonce.data()) == 1
+			&& (aad.empty() || EVP_EncryptUpdate(ctx, nullptr, &len, aad.data(), static_cast<int>(aad.size())) == 1)
+			&& EVP_EncryptUpdate(ctx, out, &len, in, static_cast<int>(size)) == 1
+			&& EVP_EncryptFinal_ex(ctx, out + len, &finalLen) == 1
+			&& EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, tagSize, out + len + finalLen) == 1;
+
+		outSize = ok ? static_cast<size_t>(len + finalLen) + tagSize : 0;
+		return ok;
+	}
+
+	/**
+	 * @brief AEAD decrypt: verifies the trailing tag, fails on any mismatch.
+	 */
+	bool openAead(const uint8_t* in, size_t size, uint8_t* out, size_t& outSize, std::span<const uint8_t> aad)
+	{
+		outSize = 0;
+		if(size < tagSize) return false;
+
+		EVP_CIPHER_CTX* ctx = decryptCtx_.get();
+		const auto nonce = nextNonce(recvIv_, !serverSide_, recvCounter_);
+		const size_t cipherSize = size - tagSize;
+
+		// Copy the tag first: with in-place decryption out aliases in
+		std::array<uint8_t, tagSize> tag;
+		std::memcpy(tag.data(), in + cipherSize, tagSize);
+
+		int len = 0;
+		int finalLen = 0;
+		bool ok = EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, nonce.data()) == 1
+			&& (aad.empty() || EVP_DecryptUpdate(ctx, nullptr, &len, aad.data(), static_cast<int>(aad.size())) == 1)
+			&& EVP_DecryptUpdate(ctx, out, &len, in, static_cast<int>(cipherSize)) == 1
+			&& EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, tagSize, tag.data()) == 1
+			&& EVP_DecryptFinal_ex(ctx, out + len, &finalLen) == 1;
+
+		if(ok) outSize = static_cast<size_t>(len + finalLen);
+		return ok;
+	}
+
+	/**
+	 * @struct CipherCtxDeleter
+	 * @brief Frees an EVP_CIPHER_CTX owned by a unique_ptr.
+	 */
+	struct CipherCtxDeleter
+	{
+		void operator()(EVP_CIPHER_CTX* ctx) const { EVP_CIPHER_CTX_free(ctx); }
+	};
+
+	/**
+	 * @struct PkeyCtxDeleter
+	 * @brief Frees an EVP_PKEY_CTX owned by a unique_ptr.
+	 */
+	struct PkeyCtxDeleter
+	{
+		void operator()(EVP_PKEY_CTX* ctx) const { EVP_PKEY_CTX_free(ctx); }
+	};
+
+	using CipherCtx = std::unique_ptr<EVP_CIPHER_CTX, CipherCtxDeleter>;
+
+	std::vector<uint8_t> key_; /**< Shared secret key (32 bytes); only used to derive session keys. */
+	std::vector<uint8_t> iv_;  /**< Shared secret IV (16 bytes); only used to derive session keys. */
+	CipherMode mode_;          /**< Selected cipher. */
+	CipherCtx encryptCtx_;     /**< Encrypt context keyed by beginSession(), reused per packet. */
+	CipherCtx decryptCtx_;     /**< Decrypt context keyed by acceptPeerSalt(), reused per packet. */
+	std::array<uint8_t, blockSize> sendIv_{}; /**< CBC IV, or AEAD nonce base, of the sending direction. */
+	std::array<uint8_t, blockSize> recvIv_{}; /**< CBC IV, or AEAD nonce base, of the receiving direction. */
+	bool sendReady_ = false;   /**< Sending direction keyed. */
+	bool recvReady_ = false;   /**< Receiving direction keyed. */
+	bool serverSide_ = true;   /**< Nonce direction; see setServerSide(). */
+	uint64_t sendCounter_ = 0; /**< AEAD packets encrypted so far. */
+	uint64_t recvCounter_ = 0; /**< AEAD packets decrypted so far. */
 };
@@ -0,0 +1,219 @@
+#pragma once
+
+/**
+ * @file FlatBufferPool.hpp
+ * @brief Reusable per-thread FlatBufferBuilders that finish straight into pooled Packets.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <flatbuffers/flatbuffers.h>
+#include "BufferPool.hpp"
+#include "Crypto.hpp"
+#include "FrameHeader.hpp"
+#include "Packet.hpp"
+
+/**
+ * @class PooledFlatBufferAllocator
+ * @brief flatbuffers::Allocator that draws builder storage from a BufferPool.
+ *
+ * Every block is requested with Crypto::maxOverhead spare bytes behind what the builder
+ * asked for. A builder fills its buffer back to front, so a finished buffer ends at the
+ * end of the builder's reservation and that spare room sits right after the payload,
+ * ready for the cipher's padding or tag. The free front of the reservation is the room
+ * for the FrameHeader.
+ */
+class PooledFlatBufferAllocator : public flatbuffers::Allocator
+{
+public:
+	explicit PooledFlatBufferAllocator(BufferPool& pool = BufferPool::shared())
+		: pool_(pool)
+	{
+	}
+
+	uint8_t* allocate(size_t size) override
+	{
+		PooledBuffer buffer = pool_.acquire(size + Crypto::maxOverhead);
+		uint8_t* data = buffer.data();
+		live_.push_back(std::move(buffer));
+		return data;
+	}
+
+	void deallocate(uint8_t* p, size_t) override
+	{
+		take(p);
+	}
+
+	/**
+	 * @brief Claim the block behind a pointer this allocator handed out, e.g. after FlatBufferBuilder::ReleaseRaw().
+	 * @return The block, or an empty buffer if p is unknown.
+	 */
+	PooledBuffer take(uint8_t* p)
+	{
+		// A builder holds one block, two while it grows
+		const auto found = std::find_if(live_.begin(), live_.end(), [p](const PooledBuffer& buffer) { return buffer.data() == p; });
+		if(found == live_.end()) return {};
+		PooledBuffer buffer = std::move(*found);
+		*found = std::move(live_.back());
+		live_.pop_back();
+		return buffer;
+	}
+
+private:
+	BufferPool& pool_;                /**< Source of blocks. */
+	std::vector<PooledBuffer> live_;  /**< Blocks currently held by the builder. */
+};
+
+/**
+ * @class FlatBufferPool
+ * @brief Free list of FlatBufferBuilders, one pool per thread.
+ *
+ * Building a fresh FlatBufferBuilder per message allocates its buffer and scratch space
+ * every time. A pooled builder is cleared and reused, and its storage comes from the
+ * BufferPool, so steady-state serialization on the simulation thread touches no heap.
+ * finish() hands the builder's block to the Packet instead of copying the bytes out, and
+ * the session then encrypts the frame in place around them (see Packet::frameInPlace()).
+ *
+ * @code
+ * auto builder = FlatBufferPool::local().acquire();
+ * auto root = MMO::CreatePacket(*builder, ...);
+ * session.sendPacket(builder.finish(root, LOGIN));
+ * @endcode
+ */
+class FlatBufferPool
+{
+	/**
+	 * @struct Entry
+	 * @brief A builder together with the allocator it must not outlive.
+	 */
+	struct Entry
+	{
+		Entry(size_t initialSize, BufferPool& buffers)
+			: allocator(buffers),
+			builder(initialSize, &allocator, false)
+		{
+		}
+
+		PooledFlatBufferAllocator allocator;  /**< Storage of builder; declared first so it is destroyed last. */
+		flatbuffers::FlatBufferBuilder builder; /**< Reused builder. */
+	};
+
+public:
+	/**
+	 * @class Lease
+	 * @brief A builder on loan; cleared and returned to its pool when the lease ends.
+	 */
+	class Lease
+	{
+	public:
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+		Lease(Lease&& other) noexcept : pool_(other.pool_), entry_(std::move(other.entry_)) {}
+
+		~Lease()
+		{
+			if(entry_) pool_.release(std::move(entry_));
+		}
+
+		flatbuffers::FlatBufferBuilder& operator*() { return entry_->builder; }
+		flatbuffers::FlatBufferBuilder* operator->() { return &entry_->builder; }
+
+		/**
+		 * @brief Finish the buffer and move it into a Packet without copying it.
+		 *
+		 * The builder is left cleared and can build the next message. Should the finished
+		 * buffer lack room for the FrameHeader in front, it is copied once into a block
+		 * that has it, so the session can still encrypt in place.
+		 *
+		 * @param root Root table of the message.
+		 * @param opcode Opcode written to the frame header.
+		 * @param fileIdentifier Optional 4-character file identifier of the schema.
+		 */
+		template <typename T>
+		Packet finish(flatbuffers::Offset<T> root, Opcode opcode, const char* fileIdentifier = nullptr)
+		{
+			entry_->builder.Finish(root, fileIdentifier);
+			size_t reserved = 0;
+			size_t offset = 0;
+			uint8_t* raw = entry_->builder.ReleaseRaw(reserved, offset);
+			PooledBuffer buffer = entry_->allocator.take(raw);
+			const size_t size = reserved - offset;
+
+			if(offset < sizeof(FrameHeader))
+			{
+				PooledBuffer framed = pool_.buffers_.acquire(sizeof(FrameHeader) + size + Crypto::maxOverhead);
+				std::memcpy(framed.data() + sizeof(FrameHeader), raw + offset, size);
+				buffer = std::move(framed);
+				offset = sizeof(FrameHeader);
+			}
+			return Packet(BufferSlice(std::move(buffer), offset, size), opcode, FrameFlags::Flatbuffers);
+		}
+
+	private:
+		friend class FlatBufferPool;
+
+		Lease(FlatBufferPool& pool, std::unique_ptr<Entry> entry)
+			: pool_(pool), entry_(std::move(entry))
+		{
+		}
+
+		FlatBufferPool& pool_;         /**< Pool the builder returns to. */
+		std::unique_ptr<Entry> entry_; /**< Builder on loan; nullptr once moved from. */
+	};
+
+	/**
+	 * @brief Create an empty pool.
+	 * @param initialSize Initial buffer size of each builder it creates.
+	 * @param buffers Pool builder storage comes from.
+	 */
+	explicit FlatBufferPool(size_t initialSize = 1024, BufferPool& buffers = BufferPool::shared())
+		: initialSize_(initialSize),
+		buffers_(buffers)
+	{
+	}
+
+	FlatBufferPool(const FlatBufferPool&) = delete;
+	FlatBufferPool& operator=(const FlatBufferPool&) = delete;
+
+	/**
+	 * @brief Borrow a cleared builder, creating one if every builder is on loan.
+	 */
+	Lease acquire()
+	{
+		if(free_.empty())
+			return Lease(*this, std::make_unique<Entry>(initialSize_, buffers_));
+
+		std::unique_ptr<Entry> entry = std::move(free_.back());
+		free_.pop_back();
+		return Lease(*this, std::move(entry));
+	}
+
+	/**
+	 * @brief Builders waiting to be reused.
+	 */
+	size_t idle() const { return free_.size(); }
+
+	/**
+	 * @brief Pool of the calling thread; leases must end on the thread that took them.
+	 */
+	static FlatBufferPool& local()
+	{
+		thread_local FlatBufferPool pool;
+		return pool;
+	}
+
+private:
+	void release(std::unique_ptr<Entry> entry)
+	{
+		entry->builder.Clear();
+		free_.push_back(std::move(entry));
+	}
+
+	size_t initialSize_;                       /**< Initial buffer size of new builders. */
+	BufferPool& buffers_;                      /**< Source of builder and packet storage. */
+	std::vector<std::unique_ptr<Entry>> free_; /**< Idle builders. */
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+ * @file FrameHeader.hpp
+ * @brief Cleartext header in front of every encrypted frame on the wire.
+ */
+
+#include <cstdint>
+#include <Core/Utility/EnumFlags.hpp>
+#include "Opcodes.hpp"
+
+/**
+ * @enum FrameFlags
+ * @brief Bits of FrameHeader::flags.
+ */
+enum class FrameFlags : uint8_t
+{
+	None = 0,
+	Flatbuffers = 1 << 0, /**< Payload is a Flatbuffers table; otherwise a registered hard packet. */
+	Compressed = 1 << 1,  /**< Payload is compressed. Reserved: no codec yet, frames carrying it are rejected. */
+	Batched = 1 << 2,     /**< Payload holds several messages. Reserved: rejected until supported. */
+	Fragment = 1 << 3,    /**< Payload is one chunk of a bulk message; chunks arrive in order, possibly interleaved with whole frames. */
+	FinalFragment = 1 << 4 /**< With Fragment: last chunk, the message is complete. */
+};
+ENABLE_BITMASK(FrameFlags)
+
+#pragma pack(push, 1)
+
+/**
+ * @struct FrameHeader
+ * @brief Wire layout: [FrameHeader][encrypted payload of length bytes].
+ *
+ * The header is sent in clear so a frame can be validated and routed before any
+ * decryption or decoding. In the AEAD cipher modes it is authenticated as associated
+ * data, so tampering with it fails the tag check. Each peer's first frame is preceded
+ * by its Crypto::saltSize-byte salt (see Crypto::beginSession()).
+ */
+struct FrameHeader
+{
+	static constexpr uint8_t currentVersion = 1; /**< Version written by this build. */
+
+	uint32_t length;  /**< Encrypted payload bytes following the header. */
+	uint8_t version;  /**< Protocol version, currentVersion. */
+	uint8_t flags;    /**< FrameFlags bits. */
+	uint16_t opcode;  /**< Opcode of the payload. */
+
+	/**
+	 * @brief Build a header for an outgoing frame.
+	 * @param opcode Payload opcode.
+	 * @param flags Payload kind and options.
+	 * @param length Encrypted payload size.
+	 */
+	static FrameHeader make(uint16_t opcode, FrameFlags flags, uint32_t length)
+	{
+		return FrameHeader{ length, currentVersion, to_underlying(flags), opcode };
+	}
+
+	/**
+	 * @brief Flags as a typed value.
+	 */
+	FrameFlags frameFlags() const { return static_cast<FrameFlags>(flags); }
+
+	/**
+	 * @brief True if the payload is Flatbuffers rather than a hard packet.
+	 */
+	bool isFlatbuffers() const { return HasFlag(frameFlags(), FrameFlags::Flatbuffers); }
+
+	/**
+	 * @brief True if the payload is a chunk of a bulk message.
+	 */
+	bool isFragment() const { return HasFlag(frameFlags(), FrameFlags::Fragment); }
+
+	/**
+	 * @brief True if the payload is the last chunk of a bulk message.
+	 */
+	bool isFinalFragment() const { return HasFlag(frameFlags(), FrameFlags::FinalFragment); }
+
+	/**
+	 * @brief True if this build can process the frame at all.
+	 * @param maxLength Largest accepted payload size.
+	 * @param supported Flags the receiver handles; peers that reassemble bulk messages add the fragment bits.
+	 */
+	bool isSupported(uint32_t maxLength, FrameFlags supported = FrameFlags::Flatbuffers) const
+	{
+		return version == currentVersion
+			&& (frameFlags() & ~supported) == FrameFlags::None
+			&& (isFragment() || !isFinalFragment())
+			&& length <= maxLength;
+	}
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(FrameHeader) == 8, "FrameHeader must stay 8 bytes on the wire");
@@ -5,23 +5,25 @@
  * @brief Represents a decoded packet for ECS/game loop.
  */
 
-#include <vector>
-#include <memory>
+#include "BufferPool.hpp"
 #include "Opcodes.hpp"
-
-/**
- * @class ClientSession
- * @brief Forward declaration for session pointer.
- */
-class ClientSession;
+#include "PacketTrace.hpp"
+#include "SessionHandle.hpp"
 
 /**
  * @struct GameEvent
  * @brief Carries a received opcode, raw payload, and the session it came from.
+ *
+ * Holds no strong reference to the session: resolve the handle through the Server's
+ * SessionRegistry when a reply is needed. An event is a few dozen bytes of plain fields:
+ * the opcode, the handle, a BufferSlice (buffer pointer, offset and length) and the trace
+ * stamps. Moving one copies those and steals the slice's buffer, so queuing touches neither
+ * the allocator nor any refcount.
  */
 struct GameEvent
 {
-	Opcode opcode;                          /**< Decoded opcode. */
-	std::vector<uint8_t> payload;           /**< Raw payload bytes. */
-	std::shared_ptr<ClientSession> session; /**< Source session. */
+	Opcode opcode = NONE;                   /**< Decoded opcode. */
+	SessionHandle session;                  /**< Source session. */
+	BufferSlice payload;                    /**< Decrypted payload, a view into a pooled receive buffer. */
+	PacketTimestamps trace;                 /**< Stage stamps while PacketTrace is enabled, else zero. */
 };
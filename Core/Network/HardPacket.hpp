@@ -6,6 +6,7 @@
  */
 
 #include <cstdint>
+#include "Opcodes.hpp"
 
 #pragma pack(push, 1)
 
@@ -26,6 +27,8 @@ struct HardPacket
  */
 struct HardMovePacket : public HardPacket
 {
+	static constexpr Opcode packetOpcode = MOVE; /**< Opcode this layout is registered under. */
+
 	uint32_t playerId; /**< Unique player ID */
 	float x;           /**< X position */
 	float y;           /**< Y position */
@@ -36,7 +39,7 @@ struct HardMovePacket : public HardPacket
 	 */
 	HardMovePacket()
 	{
-		opcode = 1001; // MOVE opcode
+		opcode = packetOpcode;
 	}
 };
 
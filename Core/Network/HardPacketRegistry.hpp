@@ -0,0 +1,146 @@
+#pragma once
+
+/**
+ * @file HardPacketRegistry.hpp
+ * @brief Compile-time opcode to hard packet layout registry and typed views.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include "HardPacket.hpp"
+
+/**
+ * @struct HardPacketList
+ * @brief Type list of registered hard packet structs, queried by opcode.
+ *
+ * Every entry must derive from HardPacket, be packed (alignment 1), trivially copyable
+ * and declare a static packetOpcode.
+ *
+ * @tparam Packets Registered hard packet structs.
+ */
+template <typename... Packets>
+struct HardPacketList
+{
+	static_assert(((std::is_base_of_v<HardPacket, Packets> && std::is_trivially_copyable_v<Packets> && alignof(Packets) == 1) && ...),
+				  "Hard packets must be packed, trivially copyable HardPacket structs");
+
+	/**
+	 * @brief True if the opcode maps to a registered hard packet.
+	 */
+	static constexpr bool contains(uint16_t opcode)
+	{
+		return ((opcode == Packets::packetOpcode) || ...);
+	}
+
+	/**
+	 * @brief Wire size of the packet registered for an opcode.
+	 * @return sizeof the struct, or 0 if the opcode is not registered.
+	 */
+	static constexpr size_t sizeOf(uint16_t opcode)
+	{
+		size_t size = 0;
+		((opcode == Packets::packetOpcode ? (size = sizeof(Packets), true) : false) || ...);
+		return size;
+	}
+
+	/**
+	 * @brief True if bytes hold exactly one registered hard packet.
+	 * @param bytes Decrypted payload starting with the HardPacket opcode.
+	 */
+	static bool validate(std::span<const uint8_t> bytes)
+	{
+		if(bytes.size() < sizeof(HardPacket)) return false;
+		uint16_t opcode = 0;
+		std::memcpy(&opcode, bytes.data(), sizeof(opcode));
+		const size_t size = sizeOf(opcode);
+		return size != 0 && bytes.size() == size;
+	}
+
+	/**
+	 * @brief True if bytes hold exactly the registered packet for an expected opcode.
+	 * @param opcode Opcode announced by the frame header.
+	 * @param bytes Decrypted payload starting with the HardPacket opcode.
+	 */
+	static bool validate(uint16_t opcode, std::span<const uint8_t> bytes)
+	{
+		if(!validate(bytes)) return false;
+		uint16_t embedded = 0;
+		std::memcpy(&embedded, bytes.data(), sizeof(embedded));
+		return embedded == opcode;
+	}
+};
+
+/**
+ * @brief The registry used by ClientSession and Client. Add new hard packets here.
+ */
+using HardPackets = HardPacketList<HardMovePacket>;
+
+/**
+ * @class HardPacketView
+ * @brief Bounds-checked, typed view of a hard packet over decrypted bytes; nothing is copied.
+ *
+ * Hard packets are packed, so the struct can be overlaid on any byte address.
+ *
+ * @tparam P Registered hard packet struct.
+ */
+template <typename P>
+class HardPacketView
+{
+public:
+	/**
+	 * @brief Create a view if the bytes are exactly one P with P's opcode.
+	 * @param bytes Decrypted payload.
+	 */
+	static std::optional<HardPacketView> from(std::span<const uint8_t> bytes)
+	{
+		if(bytes.size() != sizeof(P)) return std::nullopt;
+		uint16_t opcode = 0;
+		std::memcpy(&opcode, bytes.data(), sizeof(opcode));
+		if(opcode != P::packetOpcode) return std::nullopt;
+		return HardPacketView(reinterpret_cast<const P*>(bytes.data()));
+	}
+
+	const P& operator*() const { return *packet_; }
+	const P* operator->() const { return packet_; }
+
+private:
+	explicit HardPacketView(const P* packet) : packet_(packet) {}
+
+	const P* packet_; /**< Packet overlaid on the payload bytes. */
+};
+
+/**
+ * @struct HardPacketRoute
+ * @brief PacketRoute for a hard packet handler taking the typed packet.
+ *
+ * @code
+ * void onMove(ClientSession& session, const HardMovePacket& move);
+ * PacketDispatcher<ClientSession, HardPacketRoute<&onMove>> dispatcher;
+ * @endcode
+ *
+ * Payloads that fail the size/opcode check are dropped without calling the handler.
+ *
+ * @tparam Fn Function of the form void(T&, const P&).
+ */
+template <auto Fn>
+struct HardPacketRoute
+{
+private:
+	template <typename T, typename P>
+	static P packetType(void (*)(T&, const P&));
+
+public:
+	using Packet = decltype(packetType(Fn));                  /**< Routed hard packet struct. */
+	static constexpr uint16_t opcode = Packet::packetOpcode; /**< Routed opcode. */
+
+	template <typename T>
+	static void invoke(T& session, std::span<const uint8_t> payload)
+	{
+		if(auto view = HardPacketView<Packet>::from(payload))
+			Fn(session, **view);
+	}
+};
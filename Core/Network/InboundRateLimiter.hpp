@@ -0,0 +1,176 @@
+#pragma once
+
+/**
+ * @file InboundRateLimiter.hpp
+ * @brief Per-session token buckets for inbound frames, checked before decryption.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "FrameHeader.hpp"
+#include "Opcodes.hpp"
+#include "SessionOptions.hpp"
+#include "TokenBucket.hpp"
+
+/**
+ * @enum FrameAdmission
+ * @brief Verdict on an inbound frame from its header alone.
+ */
+enum class FrameAdmission
+{
+	Accept, /**< Decrypt and queue the frame. */
+	Skip,   /**< Over the limit: consume the bytes without decrypting them. */
+	Close   /**< Over the limit: close the session. */
+};
+
+/**
+ * @class InboundRateLimiter
+ * @brief Frame and byte token buckets per RateClass for one session.
+ *
+ * Only the cleartext FrameHeader is needed, so a flood of maximum-size frames costs a
+ * header read and two bucket updates per frame, not an AES pass over 64 KB. A
+ * default-constructed limiter, or one with every rate at 0, holds no buckets and admits
+ * everything. Not thread-safe; owned by the session's strand.
+ */
+class InboundRateLimiter
+{
+public:
+	InboundRateLimiter() = default;
+
+	/**
+	 * @brief Build full buckets from the configured limits.
+	 * @param limits Per-class limits and the over-limit action.
+	 * @param maxFrameBytes Largest encrypted payload; byte bursts are raised to it so any valid frame can pass.
+	 */
+	InboundRateLimiter(const InboundRateLimits& limits, uint32_t maxFrameBytes)
+		: action_(limits.action),
+		closeAfterSkipped_(limits.closeAfterSkipped)
+	{
+		const bool any = std::any_of(limits.classes.begin(), limits.classes.end(), [](const RateLimit& limit)
+									 {
+										 return limit.framesPerSecond > 0.0 || limit.bytesPerSecond > 0.0;
+									 });
+		if(!any) return;
+
+		buckets_.reserve(limits.classes.size());
+		for(const RateLimit& limit : limits.classes)
+			buckets_.push_back({ TokenBucket(limit.framesPerSecond, limit.frameBurst),
+								 TokenBucket(limit.bytesPerSecond, std::max(limit.byteBurst, static_cast<double>(maxFrameBytes))) });
+	}
+
+	/**
+	 * @brief True if any limit is configured.
+	 */
+	bool enabled() const { return !buckets_.empty(); }
+
+	/**
+	 * @brief Class an opcode is limited under.
+	 */
+	static RateClass classify(uint16_t opcode)
+	{
+		switch(opcode)
+		{
+		case PING:
+		case LOGIN:
+			return RateClass::Control;
+		case MOVE:
+			return RateClass::Movement;
+		default:
+			return RateClass::Game;
+		}
+	}
+
+	/**
+	 * @brief Charge a frame to its class; takes tokens only if both buckets allow it.
+	 * @param header Validated header of the frame.
+	 * @param now Current time.
+	 */
+	FrameAdmission admit(const FrameHeader& header, TokenBucket::Clock::time_point now = TokenBucket::Clock::now())
+	{
+		if(buckets_.empty()) return FrameAdmission::Accept;
+
+		ClassBuckets& buckets = buckets_[static_cast<size_t>(classify(header.opcode))];
+		if(buckets.frames.timeUntil(1.0, now) == TokenBucket::Clock::duration::zero()
+		   && buckets.bytes.timeUntil(header.length, now) == TokenBucket::Clock::duration::zero())
+		{
+			buckets.frames.tryTake(1.0, now);
+			buckets.bytes.tryTake(header.length, now);
+			return FrameAdmission::Accept;
+		}
+
+		if(action_ == OverLimitAction::Close) return FrameAdmission::Close;
+		++skipped_;
+		return closeAfterSkipped_ && skipped_ >= closeAfterSkipped_ ? FrameAdmission::Close : FrameAdmission::Skip;
+	}
+
+	/**
+	 * @brief Frames skipped so far.
+	 */
+	uint64_t skipped() const { return skipped_; }
+
+	/**
+	 * @brief True for one decrypt in decryptSampleEvery while enabled; the caller times it and calls recordDecrypt().
+	 */
+	bool sampleDecrypt()
+	{
+		if(buckets_.empty()) return false;
+		if(decryptCountdown_ > 0)
+		{
+			--decryptCountdown_;
+			return false;
+		}
+		decryptCountdown_ = decryptSampleEvery - 1;
+		return true;
+	}
+
+	/**
+	 * @brief Fold a timed decrypt into the cost model.
+	 *
+	 * Small frames measure the fixed per-frame cost, larger ones the cost per byte on top
+	 * of it; both are moving averages.
+	 */
+	void recordDecrypt(uint32_t bytes, std::chrono::nanoseconds elapsed)
+	{
+		const double nanos = static_cast<double>(elapsed.count());
+		if(bytes <= smallFrameBytes)
+			frameNanos_ = average(frameNanos_, nanos);
+		else
+			byteNanos_ = average(byteNanos_, std::max(nanos - frameNanos_, 0.0) / bytes);
+	}
+
+	/**
+	 * @brief Estimated time decrypting a frame of this size would take; 0 until a decrypt was sampled.
+	 */
+	uint64_t decryptNanos(uint32_t bytes) const
+	{
+		return static_cast<uint64_t>(frameNanos_ + byteNanos_ * bytes);
+	}
+
+private:
+	static constexpr uint32_t decryptSampleEvery = 64; /**< Decrypts per timed decrypt. */
+	static constexpr uint32_t smallFrameBytes = 256;   /**< Frames up to this size sample the fixed cost. */
+
+	static double average(double current, double sample)
+	{
+		return current == 0.0 ? sample : current + (sample - current) / 8.0;
+	}
+
+	/**
+	 * @struct ClassBuckets
+	 * @brief Both limits of one RateClass.
+	 */
+	struct ClassBuckets
+	{
+		TokenBucket frames; /**< Frames per second. */
+		TokenBucket bytes;  /**< Encrypted payload bytes per second. */
+	};
+
+	std::vector<ClassBuckets> buckets_;             /**< One entry per RateClass, or empty if unlimited. */
+	OverLimitAction action_ = OverLimitAction::Skip; /**< Handling of over-limit frames. */
+	uint32_t closeAfterSkipped_ = 0;                 /**< Skip budget before closing; 0 never. */
+	uint64_t skipped_ = 0;                           /**< Frames skipped so far. */
+	uint32_t decryptCountdown_ = decryptSampleEvery - 1; /**< Decrypts until the next timed one; the cold first decrypt is never timed. */
+	double frameNanos_ = 0.0;                        /**< Fixed decrypt cost per frame. */
+	double byteNanos_ = 0.0;                         /**< Decrypt cost per byte beyond the fixed cost. */
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+/**
+ * @file InterestGrid.hpp
+ * @brief Spatial interest management: which sessions should receive a player's movement.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "SessionHandle.hpp"
+
+/**
+ * @struct InterestOptions
+ * @brief Radii of an InterestGrid, in world units on the x/z ground plane.
+ */
+struct InterestOptions
+{
+	float enterRadius = 50.0f; /**< Two players start seeing each other within this distance. */
+	float leaveRadius = 60.0f; /**< ...and stop only beyond this one, so a player pacing on the border does not flap. */
+	float cellSize = 50.0f;    /**< Grid cell edge; about enterRadius keeps each query to a 3x3 block of cells. */
+};
+
+/**
+ * @struct InterestChange
+ * @brief One observer gaining or losing sight of one subject.
+ */
+struct InterestChange
+{
+	SessionHandle observer; /**< Session whose view changed. */
+	SessionHandle subject;  /**< Session that entered or left it. */
+	bool entered;           /**< True on enter, false on leave. */
+};
+
+/**
+ * @class InterestGrid
+ * @brief Uniform cell hash over player positions with incremental, symmetric interest sets.
+ *
+ * Every session placed with move() is both a subject and an observer, and interest is
+ * mutual: A sees B exactly when B sees A. A move only re-examines the mover's neighbourhood,
+ * so its cost depends on local density, not on how many players are online. Pairs are created
+ * within enterRadius and kept until they are farther apart than leaveRadius. Both sides of
+ * every change are reported, so the game can send spawn/despawn to each observer.
+ *
+ * Entries are indexed by SessionHandle::index like SessionRegistry slots, with the generation
+ * checked, so a reused slot never inherits the interest set of a closed session. Call
+ * remove() when a session closes (see SESSION_CLOSED). Not thread-safe; owned by the game loop.
+ *
+ * @code
+ * InterestGrid interest;
+ * std::vector<InterestChange> changes;
+ * interest.move(event.session, move.x, move.z, changes);
+ * for(SessionHandle observer : interest.observers(event.session))
+ *     sessions.visit(observer, [&](ClientSession& session) { session.sendPacket(packet); });
+ * @endcode
+ */
+class InterestGrid
+{
+public:
+	/**
+	 * @brief Create an empty grid.
+	 * @param options Radii; leaveRadius is raised to enterRadius if smaller.
+	 */
+	explicit InterestGrid(const InterestOptions& options = {})
+		: enterRadiusSquared_(options.enterRadius * options.enterRadius),
+		leaveRadiusSquared_(std::max(options.leaveRadius, options.enterRadius) * std::max(options.leaveRadius, options.enterRadius)),
+		cellSize_(std::max(options.cellSize, 1.0f)),
+		cellReach_(static_cast<int32_t>(std::ceil(options.enterRadius / cellSize_)))
+	{
+	}
+
+	/**
+	 * @brief Place or move a session and update its interest pairs.
+	 * @param session Mover; added on its first move.
+	 * @param x World x.
+	 * @param z World z; height does not affect interest.
+	 * @param changes Receives the enter/leave changes caused by this move; not cleared.
+	 */
+	void move(SessionHandle session, float x, float z, std::vector<InterestChange>& changes)
+	{
+		Entry& entry = place(session, changes);
+		entry.x = x;
+		entry.z = z;
+
+		const uint64_t cell = cellOf(x, z);
+		if(!entry.linked || cell != entry.cell)
+		{
+			if(entry.linked) unlinkFromCell(entry);
+			linkToCell(session.index, entry, cell);
+		}
+
+		// Drop pairs that drifted past leaveRadius, then stamp the survivors so the scan skips them
+		++epoch_;
+		for(size_t i = 0; i < entry.visible.size();)
+		{
+			const uint32_t other = entry.visible[i];
+			if(distanceSquared(entry, entries_[other]) > leaveRadiusSquared_)
+			{
+				unpair(session.index, other, changes);
+				continue;
+			}
+			entries_[other].mark = epoch_;
+			++i;
+		}
+
+		const auto [cellX, cellZ] = cellCoordinates(x, z);
+		for(int32_t dz = -cellReach_; dz <= cellReach_; ++dz)
+		{
+			for(int32_t dx = -cellReach_; dx <= cellReach_; ++dx)
+			{
+				const auto found = cells_.find(cellKey(cellX + dx, cellZ + dz));
+				if(found == cells_.end()) continue;
+				for(const uint32_t other : found->second)
+				{
+					Entry& candidate = entries_[other];
+					if(other == session.index || candidate.mark == epoch_) continue;
+					if(distanceSquared(entry, candidate) <= enterRadiusSquared_)
+					{
+						pair(session.index, other, changes);
+						candidate.mark = epoch_;
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Take a session out of the grid, e.g. when it disconnects.
+	 * @param session Session to remove; ignored if unknown or stale.
+	 * @param changes Receives a leave change for every former observer; not cleared.
+	 */
+	void remove(SessionHandle session, std::vector<InterestChange>& changes)
+	{
+		Entry* entry = find(session);
+		if(!entry) return;
+		while(!entry->visible.empty())
+			unpair(session.index, entry->visible.back(), changes);
+		unlinkFromCell(*entry);
+		entry->generation = 0;
+		--size_;
+	}
+
+	/**
+	 * @brief Sessions that currently see this one; empty if it is not in the grid.
+	 */
+	std::vector<SessionHandle> observers(SessionHandle session) const
+	{
+		std::vector<SessionHandle> result;
+		forEachObserver(session, [&](SessionHandle observer) { result.push_back(observer); });
+		return result;
+	}
+
+	/**
+	 * @brief Call fn(SessionHandle) for every session that currently sees this one, without allocating.
+	 */
+	template <typename Fn>
+	void forEachObserver(SessionHandle session, Fn&& fn) const
+	{
+		const Entry* entry = find(session);
+		if(!entry) return;
+		for(const uint32_t other : entry->visible)
+			fn(SessionHandle{ other, entries_[other].generation });
+	}
+
+	/**
+	 * @brief True if observer currently sees subject (and so subject sees observer).
+	 */
+	bool sees(SessionHandle observer, SessionHandle subject) const
+	{
+		const Entry* entry = find(observer);
+		return entry && find(subject)
+			&& std::find(entry->visible.begin(), entry->visible.end(), subject.index) != entry->visible.end();
+	}
+
+	/**
+	 * @brief Number of sessions in the grid.
+	 */
+	size_t size() const { return size_; }
+
+private:
+	/**
+	 * @struct Entry
+	 * @brief Position and interest set of one session.
+	 */
+	struct Entry
+	{
+		uint32_t generation = 0;      /**< SessionHandle::generation of the occupant; 0 while free. */
+		float x = 0.0f;               /**< Last position on the ground plane. */
+		float z = 0.0f;
+		bool linked = false;          /**< True while the entry is in a cell. */
+		uint64_t cell = 0;            /**< Key of the cell holding this entry. */
+		uint32_t cellSlot = 0;        /**< Position in that cell's member list. */
+		uint64_t mark = 0;            /**< Scan epoch that already handled this entry. */
+		std::vector<uint32_t> visible; /**< Indices of the sessions in mutual interest, unordered. */
+	};
+
+	/**
+	 * @brief Entry of a session, claiming its slot on first use.
+	 */
+	Entry& place(SessionHandle session, std::vector<InterestChange>& changes)
+	{
+		if(session.index >= entries_.size()) entries_.resize(session.index + 1);
+		Entry& entry = entries_[session.index];
+		if(entry.generation != session.generation)
+		{
+			// A slot left by a session that was never removed: its observers lose it first
+			if(entry.generation != 0) remove(SessionHandle{ session.index, entry.generation }, changes);
+			entry.generation = session.generation;
+			++size_;
+		}
+		return entry;
+	}
+
+	Entry* find(SessionHandle session)
+	{
+		if(session.index >= entries_.size()) return nullptr;
+		Entry& entry = entries_[session.index];
+		return entry.generation != 0 && entry.generation == session.generation ? &entry : nullptr;
+	}
+
+	const Entry* find(SessionHandle session) const
+	{
+		return const_cast<InterestGrid*>(this)->find(session);
+	}
+
+	std::pair<int32_t, int32_t> cellCoordinates(float x, float z) const
+	{
+		return { static_cast<int32_t>(std::floor(x / cellSize_)), static_cast<int32_t>(std::floor(z / cellSize_)) };
+	}
+
+	static uint64_t cellKey(int32_t cellX, int32_t cellZ)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellZ);
+	}
+
+	uint64_t cellOf(float x, float z) const
+	{
+		const auto [cellX, cellZ] = cellCoordinates(x, z);
+		return cellKey(cellX, cellZ);
+	}
+
+	static float distanceSquared(const Entry& a, const Entry& b)
+	{
+		const float dx = a.x - b.x;
+		const float dz = a.z - b.z;
+		return dx * dx + dz * dz;
+	}
+
+	void linkToCell(uint32_t index, Entry& entry, uint64_t cell)
+	{
+		std::vector<uint32_t>& members = cells_[cell];
+		entry.linked = true;
+		entry.cell = cell;
+		entry.cellSlot = static_cast<uint32_t>(members.size());
+		members.push_back(index);
+	}
+
+	/**
+	 * @brief Swap-remove an entry from its cell; emptied cells are erased so a roaming world does not grow cells_.
+	 */
+	void unlinkFromCell(Entry& entry)
+	{
+		const auto cell = cells_.find(entry.cell);
+		std::vector<uint32_t>& members = cell->second;
+		const uint32_t last = members.back();
+		members[entry.cellSlot] = last;
+		entries_[last].cellSlot = entry.cellSlot;
+		members.pop_back();
+		if(members.empty()) cells_.erase(cell);
+		entry.linked = false;
+	}
+
+	void pair(uint32_t a, uint32_t b, std::vector<InterestChange>& changes)
+	{
+		entries_[a].visible.push_back(b);
+		entries_[b].visible.push_back(a);
+		changes.push_back({ handleOf(a), handleOf(b), true });
+		changes.push_back({ handleOf(b), handleOf(a), true });
+	}
+
+	void unpair(uint32_t a, uint32_t b, std::vector<InterestChange>& changes)
+	{
+		erase(entries_[a].visible, b);
+		erase(entries_[b].visible, a);
+		changes.push_back({ handleOf(a), handleOf(b), false });
+		changes.push_back({ handleOf(b), handleOf(a), false });
+	}
+
+	static void erase(std::vector<uint32_t>& visible, uint32_t index)
+	{
+		const auto found = std::find(visible.begin(), visible.end(), index);
+		if(found == visible.end()) return;
+		*found = visible.back();
+		visible.pop_back();
+	}
+
+	SessionHandle handleOf(uint32_t index) const
+	{
+		return SessionHandle{ index, entries_[index].generation };
+	}
+
+	float enterRadiusSquared_;  /**< Pair creation threshold. */
+	float leaveRadiusSquared_;  /**< Pair removal threshold. */
+	float cellSize_;            /**< Cell edge. */
+	int32_t cellReach_;         /**< Cells scanned on each side of the mover's cell. */
+	std::vector<Entry> entries_; /**< Indexed by SessionHandle::index. */
+	std::unordered_map<uint64_t, std::vector<uint32_t>> cells_; /**< Occupied cells. */
+	uint64_t epoch_ = 0;        /**< Scan counter for Entry::mark. */
+	size_t size_ = 0;           /**< Sessions in the grid. */
+};
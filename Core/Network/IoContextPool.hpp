@@ -0,0 +1,133 @@
+#pragma once
+
+/**
+ * @file IoContextPool.hpp
+ * @brief A set of single-threaded io_contexts, one per worker thread.
+ */
+
+#include "AsioConfig.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @class IoContextPool
+ * @brief Runs N io_contexts, each on its own (optionally core-pinned) thread.
+ *
+ * Every context is created with a concurrency hint of 1, telling asio that only one
+ * thread runs it; this is a scheduling hint and does not remove asio's internal
+ * locking. Sessions are spread across contexts with next().
+ */
+class IoContextPool
+{
+public:
+	/**
+	 * @brief Creates the contexts; threads are started by run().
+	 * @param count Number of contexts/threads. Defaults to hardware concurrency.
+	 * @param pinThreads Pin thread i to core i.
+	 */
+	explicit IoContextPool(size_t count = std::thread::hardware_concurrency(), bool pinThreads = true)
+		: pinThreads_(pinThreads)
+	{
+		if(count == 0) count = 1;
+		contexts_.reserve(count);
+		for(size_t i = 0; i < count; ++i)
+		{
+			contexts_.push_back(std::make_unique<asio::io_context>(1));
+			guards_.push_back(asio::make_work_guard(*contexts_.back()));
+		}
+	}
+
+	IoContextPool(const IoContextPool&) = delete;
+	IoContextPool& operator=(const IoContextPool&) = delete;
+
+	/**
+	 * @brief Stops all contexts and joins their threads.
+	 */
+	~IoContextPool()
+	{
+		stop();
+	}
+
+	/**
+	 * @brief Starts one thread per context.
+	 */
+	void run()
+	{
+		for(size_t i = 0; i < contexts_.size(); ++i)
+		{
+			threads_.emplace_back([this, i]()
+								  {
+									  if(pinThreads_) pinCurrentThread(i);
+									  contexts_[i]->run();
+								  });
+		}
+	}
+
+	/**
+	 * @brief Stops all contexts and joins their threads.
+	 */
+	void stop()
+	{
+		guards_.clear();
+		for(auto& context : contexts_)
+			context->stop();
+
+		for(auto& thread : threads_)
+		{
+			if(thread.joinable()) thread.join();
+		}
+		threads_.clear();
+	}
+
+	/**
+	 * @brief Picks the next context in round-robin order.
+	 */
+	asio::io_context& next()
+	{
+		return *contexts_[next_.fetch_add(1, std::memory_order_relaxed) % contexts_.size()];
+	}
+
+	/**
+	 * @brief Access context i.
+	 */
+	asio::io_context& at(size_t i) { return *contexts_[i]; }
+
+	/**
+	 * @brief Number of contexts.
+	 */
+	size_t size() const { return contexts_.size(); }
+
+private:
+	/**
+	 * @brief Restricts the calling thread to one core (best effort).
+	 * @param index Worker index, wrapped to the available cores.
+	 */
+	static void pinCurrentThread(size_t index)
+	{
+		const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+		const size_t core = index % cores;
+#if defined(_WIN32)
+		if(core < 64) SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+		(void)core;
+#endif
+	}
+
+	std::vector<std::unique_ptr<asio::io_context>> contexts_;                          /**< One context per thread. */
+	std::vector<asio::executor_work_guard<asio::io_context::executor_type>> guards_;  /**< Keep run() alive while idle. */
+	std::vector<std::thread> threads_;                                                /**< Worker threads. */
+	std::atomic<size_t> next_{ 0 };                                                   /**< Round-robin cursor. */
+	bool pinThreads_;                                                                 /**< Pin workers to cores. */
+};
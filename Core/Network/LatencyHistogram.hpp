@@ -0,0 +1,85 @@
+#pragma once
+
+/**
+ * @file LatencyHistogram.hpp
+ * @brief Fixed-size, lock-free histogram for latency percentiles.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class LatencyHistogram
+ * @brief Lock-free log-linear histogram of nanosecond samples, 16 sub-buckets per power of two.
+ *
+ * Percentiles are accurate to about 6%, memory is fixed and record() is one relaxed
+ * atomic increment, so every io thread can record into the same instance.
+ */
+class LatencyHistogram
+{
+public:
+	/**
+	 * @brief Count one sample.
+	 * @param nanoseconds Measured latency.
+	 */
+	void record(uint64_t nanoseconds)
+	{
+		counts_[indexOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Copy of the bucket counts, for consistent percentiles over one moment.
+	 */
+	std::vector<uint64_t> snapshot() const
+	{
+		std::vector<uint64_t> counts(counts_.size());
+		for(size_t i = 0; i < counts_.size(); ++i)
+			counts[i] = counts_[i].load(std::memory_order_relaxed);
+		return counts;
+	}
+
+	/**
+	 * @brief Value at a quantile of a snapshot, in nanoseconds; 0 if empty.
+	 * @param counts Result of snapshot().
+	 * @param quantile In [0, 1].
+	 */
+	static uint64_t percentile(const std::vector<uint64_t>& counts, double quantile)
+	{
+		uint64_t total = 0;
+		for(uint64_t count : counts) total += count;
+		if(total == 0) return 0;
+
+		const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.5));
+		uint64_t seen = 0;
+		for(size_t i = 0; i < counts.size(); ++i)
+		{
+			seen += counts[i];
+			if(seen >= rank) return valueOf(i);
+		}
+		return valueOf(counts.size() - 1);
+	}
+
+private:
+	static constexpr unsigned subBits = 4;
+	static constexpr size_t subBuckets = size_t(1) << subBits;
+
+	static size_t indexOf(uint64_t value)
+	{
+		if(value < subBuckets) return static_cast<size_t>(value);
+		const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - 1 - subBits;
+		return (shift + 1) * subBuckets + static_cast<size_t>((value >> shift) & (subBuckets - 1));
+	}
+
+	static uint64_t valueOf(size_t index)
+	{
+		if(index < subBuckets) return index;
+		const size_t shift = index / subBuckets - 1;
+		return (subBuckets + index % subBuckets) << shift;
+	}
+
+	std::array<std::atomic<uint64_t>, (64 - subBits + 1) * subBuckets> counts_{};
+};
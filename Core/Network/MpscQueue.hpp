@@ -0,0 +1,146 @@
+#pragma once
+
+/**
+ * @file MpscQueue.hpp
+ * @brief Lock-free multi-producer, single-consumer FIFO queue.
+ */
+
+#include <atomic>
+#include <utility>
+
+/**
+ * @class MpscQueue
+ * @brief Unbounded intrusive-node queue (Vyukov MPSC).
+ *
+ * push() is a single atomic exchange plus a store and never waits on other producers
+ * or on the consumer. pop() must only be called from one consumer at a time (e.g. a strand).
+ * Items from the same producer are popped in the order they were pushed.
+ *
+ * Nodes are recycled instead of freed: pop() hands each spent node to the queue's free
+ * list, and a producer takes that whole list with one exchange into a thread-local cache
+ * when its own runs dry. Taking the whole list, never one node, keeps the free list free
+ * of ABA. The allocator is only touched while the queue grows past its previous peak.
+ *
+ * @tparam T Item type; must be default constructible.
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+	MpscQueue()
+	{
+		Node* stub = new Node();
+		head_.store(stub, std::memory_order_relaxed);
+		tail_ = stub;
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	~MpscQueue()
+	{
+		deleteChain(tail_);
+		deleteChain(free_.load(std::memory_order_acquire));
+	}
+
+	/**
+	 * @brief Push an item; safe from any number of threads.
+	 * @param item The item to add.
+	 */
+	void push(T item)
+	{
+		Node* node = allocate();
+		node->value = std::move(item);
+		Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+		prev->next.store(node, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Pop the oldest item. Consumer only.
+	 * @param item The popped item will be stored here.
+	 * @return True if an item was popped, false if empty (or a push is mid-flight).
+	 */
+	bool pop(T& item)
+	{
+		Node* tail = tail_;
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if(!next) return false;
+
+		item = std::move(next->value);
+		next->value = T();
+		tail_ = next;
+		recycle(tail);
+		return true;
+	}
+
+	/**
+	 * @brief Check whether the consumer would find an item. Consumer only.
+	 */
+	bool empty() const
+	{
+		return tail_->next.load(std::memory_order_acquire) == nullptr;
+	}
+
+private:
+	/**
+	 * @struct Node
+	 * @brief Linked list cell; the consumer's current tail is a placeholder.
+	 */
+	struct Node
+	{
+		std::atomic<Node*> next{ nullptr }; /**< Next newer node. */
+		T value{};                          /**< Stored item. */
+	};
+
+	/**
+	 * @struct NodeCache
+	 * @brief Spare nodes of one producer thread, shared by every MpscQueue<T> it pushes to.
+	 */
+	struct NodeCache
+	{
+		Node* head = nullptr; /**< Singly linked through Node::next. */
+
+		~NodeCache() { deleteChain(head); }
+	};
+
+	static void deleteChain(Node* node)
+	{
+		while(node)
+		{
+			Node* next = node->next.load(std::memory_order_relaxed);
+			delete node;
+			node = next;
+		}
+	}
+
+	/**
+	 * @brief Node for push(): from the thread's cache, refilled from free_, else new.
+	 */
+	Node* allocate()
+	{
+		thread_local NodeCache cache;
+		if(!cache.head) cache.head = free_.exchange(nullptr, std::memory_order_acquire);
+		if(!cache.head) return new Node();
+
+		Node* node = cache.head;
+		cache.head = node->next.load(std::memory_order_relaxed);
+		node->next.store(nullptr, std::memory_order_relaxed);
+		return node;
+	}
+
+	/**
+	 * @brief Put a node no producer can reach anymore on the free list. Consumer only.
+	 */
+	void recycle(Node* node)
+	{
+		Node* top = free_.load(std::memory_order_relaxed);
+		do
+		{
+			node->next.store(top, std::memory_order_relaxed);
+		} while(!free_.compare_exchange_weak(top, node, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	alignas(64) std::atomic<Node*> head_; /**< Most recently pushed node, shared by producers. */
+	alignas(64) Node* tail_;              /**< Placeholder before the oldest item, consumer-owned. */
+	alignas(64) std::atomic<Node*> free_{ nullptr }; /**< Spent nodes pushed by the consumer, taken whole by producers. */
+};
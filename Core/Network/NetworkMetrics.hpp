@@ -0,0 +1,91 @@
+#pragma once
+
+/**
+ * @file NetworkMetrics.hpp
+ * @brief Process-wide counters for network policies.
+ */
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @struct NetworkMetricsSnapshot
+ * @brief Plain copy of NetworkMetrics for logging or export.
+ */
+struct NetworkMetricsSnapshot
+{
+	uint64_t packetsCoalesced = 0;   /**< Queued droppable packets replaced by a newer one for the same key. */
+	uint64_t packetsDropped = 0;     /**< Droppable packets discarded because the session was over budget. */
+	uint64_t overBudgetEntered = 0;  /**< Times a session went over its outbound budget. */
+	uint64_t slowDisconnects = 0;    /**< Sessions closed for staying over budget past the grace period. */
+	uint64_t acceptsRejected = 0;    /**< Connections closed on accept because of the session or pending-handshake cap. */
+	uint64_t acceptPauses = 0;       /**< Times an acceptor paused because the accept rate limit was exhausted; connections wait in the backlog meanwhile. */
+	uint64_t handshakeTimeouts = 0;  /**< Sessions closed for not sending a valid frame in time. */
+	uint64_t sessionPoolOverflows = 0; /**< Sessions allocated on the heap because the SessionPool was exhausted. */
+	uint64_t framesRateLimited = 0;  /**< Inbound frames skipped for exceeding their session's rate limit. */
+	uint64_t bytesNotDecrypted = 0;  /**< Encrypted bytes of rate-limited frames that were never decrypted. */
+	uint64_t decryptNanosSaved = 0;  /**< Estimated decrypt CPU time those bytes would have cost, from sampled decrypt timings. */
+	uint64_t rateLimitDisconnects = 0; /**< Sessions closed by their inbound rate limit. */
+};
+
+/**
+ * @class NetworkMetrics
+ * @brief Relaxed atomic counters bumped by sessions whenever a policy triggers.
+ *
+ * Counters only ever increase; read them with snapshot() and diff successive snapshots
+ * for rates.
+ */
+class NetworkMetrics
+{
+public:
+	std::atomic<uint64_t> packetsCoalesced{ 0 };
+	std::atomic<uint64_t> packetsDropped{ 0 };
+	std::atomic<uint64_t> overBudgetEntered{ 0 };
+	std::atomic<uint64_t> slowDisconnects{ 0 };
+	std::atomic<uint64_t> acceptsRejected{ 0 };
+	std::atomic<uint64_t> acceptPauses{ 0 };
+	std::atomic<uint64_t> handshakeTimeouts{ 0 };
+	std::atomic<uint64_t> sessionPoolOverflows{ 0 };
+	std::atomic<uint64_t> framesRateLimited{ 0 };
+	std::atomic<uint64_t> bytesNotDecrypted{ 0 };
+	std::atomic<uint64_t> decryptNanosSaved{ 0 };
+	std::atomic<uint64_t> rateLimitDisconnects{ 0 };
+
+	/**
+	 * @brief Increment a counter without ordering constraints.
+	 */
+	static void bump(std::atomic<uint64_t>& counter, uint64_t amount = 1)
+	{
+		counter.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Copy the current counter values.
+	 */
+	NetworkMetricsSnapshot snapshot() const
+	{
+		NetworkMetricsSnapshot result;
+		result.packetsCoalesced = packetsCoalesced.load(std::memory_order_relaxed);
+		result.packetsDropped = packetsDropped.load(std::memory_order_relaxed);
+		result.overBudgetEntered = overBudgetEntered.load(std::memory_order_relaxed);
+		result.slowDisconnects = slowDisconnects.load(std::memory_order_relaxed);
+		result.acceptsRejected = acceptsRejected.load(std::memory_order_relaxed);
+		result.acceptPauses = acceptPauses.load(std::memory_order_relaxed);
+		result.handshakeTimeouts = handshakeTimeouts.load(std::memory_order_relaxed);
+		result.sessionPoolOverflows = sessionPoolOverflows.load(std::memory_order_relaxed);
+		result.framesRateLimited = framesRateLimited.load(std::memory_order_relaxed);
+		result.bytesNotDecrypted = bytesNotDecrypted.load(std::memory_order_relaxed);
+		result.decryptNanosSaved = decryptNanosSaved.load(std::memory_order_relaxed);
+		result.rateLimitDisconnects = rateLimitDisconnects.load(std::memory_order_relaxed);
+		return result;
+	}
+
+	/**
+	 * @brief Metrics shared by every session in the process.
+	 */
+	static NetworkMetrics& shared()
+	{
+		static NetworkMetrics metrics;
+		return metrics;
+	}
+};
@@ -17,5 +17,7 @@ enum Opcode : uint16_t
 	PING = 1,   /**< Flatbuffers PING. */
 	LOGIN = 2,  /**< Flatbuffers LOGIN. */
 
-	MOVE = 1001 /**< Hard packet MOVE. */
+	MOVE = 1001, /**< Hard packet MOVE. */
+
+	SESSION_CLOSED = 0xFFFF /**< Local only: queued by a session when it closes, so the game loop can forget it. Never valid on the wire. */
 };
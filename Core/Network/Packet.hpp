@@ -8,20 +8,70 @@
 #include <vector>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <span>
+#include <utility>
+#include "BufferPool.hpp"
+#include "FrameHeader.hpp"
 #include "HardPacket.hpp"
+#include "Opcodes.hpp"
+
+/**
+ * @enum PacketLane
+ * @brief Outbound queue of a session a packet is written from.
+ */
+enum class PacketLane : uint8_t
+{
+	Auto,     /**< Bulk if the payload is over SessionOptions::bulkThreshold, critical otherwise. */
+	Critical, /**< Small latency-sensitive messages, always written first. */
+	Bulk      /**< Large payloads, sent in chunks between critical packets. */
+};
 
 /**
  * @class Packet
  * @brief Wraps a buffer holding serialized data (Flatbuffers or hard packets).
+ *
+ * The payload is owned by the packet, a refcounted immutable buffer shared with other
+ * packets, or a slice of a pooled buffer (see FlatBufferPool). Copying a shared packet only bumps the refcount, so one payload
+ * broadcast to many sessions is serialized once and never copied; each session still
+ * encrypts it into its own frame.
+ *
+ * @code
+ * Packet update(move, sizeof(move));
+ * update.share();
+ * for(SessionHandle observer : observers)
+ *     sessions.visit(observer, [&](ClientSession& session) { session.sendPacket(update); });
+ * @endcode
  */
 class Packet
 {
 public:
+	using SharedPayload = std::shared_ptr<const std::vector<uint8_t>>; /**< Immutable payload shared between packets. */
+
+	/**
+	 * @brief Construct an empty packet, e.g. as a pop target.
+	 */
+	Packet() = default;
+
+	/**
+	 * @brief Construct from a serialized Flatbuffers buffer.
+	 * @param buffer Raw serialized packet bytes.
+	 * @param opcode Opcode written to the frame header.
+	 */
+	Packet(const std::vector<uint8_t>& buffer, Opcode opcode = NONE)
+		: buffer_(buffer), opcode_(opcode), flags_(FrameFlags::Flatbuffers)
+	{
+	}
+
 	/**
-	 * @brief Construct from a raw byte buffer.
+	 * @brief Construct from a serialized Flatbuffers buffer, taking it over without a copy.
 	 * @param buffer Raw serialized packet bytes.
+	 * @param opcode Opcode written to the frame header.
 	 */
-	Packet(const std::vector<uint8_t>& buffer) : buffer_(buffer) {}
+	Packet(std::vector<uint8_t>&& buffer, Opcode opcode = NONE)
+		: buffer_(std::move(buffer)), opcode_(opcode), flags_(FrameFlags::Flatbuffers)
+	{
+	}
 	 
 	/**
 	 * @brief Construct a Packet directly from any HardPacket.
@@ -35,16 +85,141 @@ public:
 	 * @endcode
 	 */
 	Packet(const HardPacket& pkt, size_t size)
+		: opcode_(pkt.opcode), flags_(FrameFlags::None)
 	{
 		buffer_.resize(size);
 		std::memcpy(buffer_.data(), &pkt, size);
 	}
 
+	/**
+	 * @brief Construct around a payload shared with other packets.
+	 * @param payload Serialized bytes; never modified through the packet.
+	 * @param opcode Opcode written to the frame header.
+	 * @param flags Payload kind; FrameFlags::None for hard packets.
+	 */
+	Packet(SharedPayload payload, Opcode opcode, FrameFlags flags = FrameFlags::Flatbuffers)
+		: shared_(std::move(payload)), opcode_(opcode), flags_(flags)
+	{
+	}
+
+	/**
+	 * @brief Construct around a slice of a pooled buffer, e.g. a finished FlatBufferBuilder.
+	 *
+	 * If the packet is the buffer's only user and the slice has room for a FrameHeader in
+	 * front and Crypto::maxOverhead behind, the session builds the frame around the payload
+	 * in place instead of encrypting into a separate buffer.
+	 *
+	 * @param payload Serialized bytes.
+	 * @param opcode Opcode written to the frame header.
+	 * @param flags Payload kind; FrameFlags::None for hard packets.
+	 */
+	Packet(BufferSlice payload, Opcode opcode, FrameFlags flags = FrameFlags::Flatbuffers)
+		: pooled_(std::move(payload)), opcode_(opcode), flags_(flags)
+	{
+	}
+
+	/**
+	 * @brief Move an owned payload into a shared buffer so later copies of the packet do not copy it.
+	 * @return *this, for chaining.
+	 */
+	Packet& share()
+	{
+		if(!shared_ && !pooled_.buffer()) shared_ = std::make_shared<const std::vector<uint8_t>>(std::move(buffer_));
+		buffer_ = {};
+		return *this;
+	}
+
+	/**
+	 * @brief True if copies of the packet share its payload instead of copying it.
+	 */
+	bool isShared() const { return shared_ != nullptr || static_cast<bool>(pooled_.buffer()); }
+
+	/**
+	 * @brief Pooled buffer the frame can be built in around the payload, or nullptr.
+	 * @param headroom Bytes needed in front of the payload.
+	 * @param tailroom Bytes needed after it.
+	 * @return The buffer if the packet is its only user and it has the room; its bytes may then be overwritten.
+	 */
+	const PooledBuffer* frameInPlace(size_t headroom, size_t tailroom) const
+	{
+		const PooledBuffer& buffer = pooled_.buffer();
+		if(!buffer.unique()) return nullptr;
+		const size_t offset = static_cast<size_t>(pooled_.data() - buffer.data());
+		return offset >= headroom && buffer.capacity() - offset - pooled_.size() >= tailroom ? &buffer : nullptr;
+	}
+
 	/**
 	 * @brief Access the raw packet data.
-	 * @return Const reference to internal buffer.
+	 * @return View of the owned or shared payload, valid while the packet lives.
+	 */
+	std::span<const uint8_t> body() const
+	{
+		if(shared_) return *shared_;
+		if(pooled_.buffer()) return pooled_.span();
+		return buffer_;
+	}
+
+	/**
+	 * @brief Opcode carried in the frame header.
+	 */
+	uint16_t opcode() const { return opcode_; }
+
+	/**
+	 * @brief Frame flags (payload kind) carried in the frame header.
+	 */
+	FrameFlags flags() const { return flags_; }
+
+	/**
+	 * @brief Mark the packet as a replaceable state update.
+	 *
+	 * A droppable packet may be discarded while its session is over its outbound budget,
+	 * and an unsent one is overwritten in place by a newer droppable packet with the same
+	 * opcode and key, e.g. successive MOVE updates for one entity.
+	 *
+	 * @param coalesceKey Identity of the state being updated, e.g. the entity/player id.
+	 * @return *this, for chaining.
+	 */
+	Packet& setDroppable(uint32_t coalesceKey)
+	{
+		droppable_ = true;
+		coalesceKey_ = coalesceKey;
+		return *this;
+	}
+
+	/**
+	 * @brief Choose the outbound lane instead of letting the session pick by size.
+	 * @return *this, for chaining.
+	 */
+	Packet& setLane(PacketLane lane)
+	{
+		lane_ = lane;
+		return *this;
+	}
+
+	/**
+	 * @brief Lane requested with setLane(), PacketLane::Auto by default.
+	 */
+	PacketLane lane() const { return lane_; }
+
+	/**
+	 * @brief True if setDroppable() was called.
+	 */
+	bool droppable() const { return droppable_; }
+
+	/**
+	 * @brief Key that identifies which queued packet this one supersedes; with opcode().
+	 */
+	uint32_t coalesceKey() const { return coalesceKey_; }
+
+	/**
+	 * @brief Set when the packet was sent, in TraceClock ticks; 0 means untraced.
+	 */
+	void setTraceStamp(uint64_t stamp) { traceStamp_ = stamp; }
+
+	/**
+	 * @brief TraceClock ticks at sendPacket(), or 0.
 	 */
-	const std::vector<uint8_t>& body() const { return buffer_; }
+	uint64_t traceStamp() const { return traceStamp_; }
 
 	/**
 	 * @brief Build a Packet from any HardPacket-derived struct.
@@ -54,11 +229,17 @@ public:
 	 */
 	static Packet buildHardPacket(const HardPacket* pkt, size_t size)
 	{
-		std::vector<uint8_t> buffer(size);
-		std::memcpy(buffer.data(), pkt, size);
-		return Packet(buffer);
+		return Packet(*pkt, size);
 	}
 
 private:
-	std::vector<uint8_t> buffer_; /**< Serialized packet data */
+	std::vector<uint8_t> buffer_; /**< Serialized packet data, unless shared */
+	SharedPayload shared_;        /**< Shared serialized packet data, or nullptr */
+	BufferSlice pooled_;          /**< Pooled serialized packet data, or empty */
+	uint16_t opcode_ = NONE;      /**< Header opcode */
+	FrameFlags flags_ = FrameFlags::None; /**< Header flags */
+	bool droppable_ = false;      /**< May be dropped or coalesced under backpressure */
+	PacketLane lane_ = PacketLane::Auto; /**< Requested outbound lane */
+	uint32_t coalesceKey_ = 0;    /**< Coalescing identity, valid if droppable_ */
+	uint64_t traceStamp_ = 0;     /**< Send time for PacketTrace, 0 if untraced */
 };
@@ -0,0 +1,219 @@
+#pragma once
+
+/**
+ * @file PacketCapture.hpp
+ * @brief Binary trace files of decrypted inbound frames, for replay without sockets.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "BufferPool.hpp"
+#include "FrameHeader.hpp"
+#include "SessionHandle.hpp"
+
+#pragma pack(push, 1)
+/**
+ * @struct CaptureFileHeader
+ * @brief First bytes of a trace file.
+ */
+struct CaptureFileHeader
+{
+	static constexpr char expectedMagic[4] = { 'R', 'W', 'P', 'C' };
+	static constexpr uint16_t currentVersion = 1;
+
+	char magic[4];        /**< expectedMagic. */
+	uint16_t version;     /**< currentVersion. */
+	uint16_t recordSize;  /**< sizeof(CaptureRecordHeader), so readers can skip fields added later. */
+	int64_t startedAt;    /**< Wall clock at capture start, nanoseconds since the Unix epoch; informational. */
+};
+
+/**
+ * @struct CaptureRecordHeader
+ * @brief Per-frame record, followed by length payload bytes.
+ */
+struct CaptureRecordHeader
+{
+	uint64_t timestamp;   /**< Nanoseconds since capture start, monotonic. */
+	uint64_t session;     /**< SessionHandle::value() of the sender. */
+	uint16_t opcode;      /**< Frame opcode. */
+	uint8_t flags;        /**< FrameFlags bits. */
+	uint8_t reserved;     /**< 0. */
+	uint32_t length;      /**< Decrypted payload bytes. */
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CaptureFileHeader) == 16, "CaptureFileHeader is part of the trace file format");
+static_assert(sizeof(CaptureRecordHeader) == 24, "CaptureRecordHeader is part of the trace file format");
+
+/**
+ * @class PacketCapture
+ * @brief Appends decrypted inbound frames to a trace file; shared by every session of a Server.
+ *
+ * Set SessionOptions::capture to enable it. Each session records a frame after it is
+ * decrypted and validated, right before the GameEvent is queued, and its SESSION_CLOSED
+ * event as its last record, so a trace holds exactly the events the game loop saw.
+ * Records from all io threads go through one mutex into a
+ * buffered stream. The lock only covers copying the record into the stream buffer, unless
+ * that copy fills the buffer and it is written out.
+ */
+class PacketCapture
+{
+public:
+	/**
+	 * @brief Create or truncate the trace file and write its header.
+	 * @param path Trace file.
+	 * @param bufferSize Stream buffer; larger values mean fewer, bigger writes.
+	 */
+	explicit PacketCapture(const std::string& path, size_t bufferSize = 1024 * 1024)
+		: streamBuffer_(bufferSize),
+		start_(std::chrono::steady_clock::now())
+	{
+		file_.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+		if(!file_)
+			throw std::runtime_error("Failed to open capture file: " + path);
+		// After open() and before the first write: MSVC's filebuf ignores a buffer set while closed
+		file_.rdbuf()->pubsetbuf(streamBuffer_.data(), static_cast<std::streamsize>(streamBuffer_.size()));
+
+		CaptureFileHeader header{};
+		std::memcpy(header.magic, CaptureFileHeader::expectedMagic, sizeof(header.magic));
+		header.version = CaptureFileHeader::currentVersion;
+		header.recordSize = sizeof(CaptureRecordHeader);
+		header.startedAt = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+
+	PacketCapture(const PacketCapture&) = delete;
+	PacketCapture& operator=(const PacketCapture&) = delete;
+
+	~PacketCapture()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		file_.flush();
+	}
+
+	/**
+	 * @brief Append one frame; callable from any thread.
+	 * @param session Sender.
+	 * @param opcode Frame opcode.
+	 * @param flags Frame flags.
+	 * @param payload Decrypted payload.
+	 */
+	void record(SessionHandle session, uint16_t opcode, FrameFlags flags, std::span<const uint8_t> payload)
+	{
+		CaptureRecordHeader header{};
+		header.session = session.value();
+		header.opcode = opcode;
+		header.flags = to_underlying(flags);
+		header.length = static_cast<uint32_t>(payload.size());
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		// Stamped under the lock so timestamps never go backwards in the file
+		header.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+		file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file_.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+		records_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Write buffered records to disk, e.g. before copying a trace of a running server.
+	 */
+	void flush()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		file_.flush();
+	}
+
+	/**
+	 * @brief Frames recorded so far.
+	 */
+	uint64_t records() const { return records_.load(std::memory_order_relaxed); }
+
+private:
+	std::vector<char> streamBuffer_;       /**< Backing store of file_'s buffer; declared first so it outlives file_. */
+	std::ofstream file_;                   /**< Trace file. */
+	std::mutex mutex_;                     /**< Serializes records from all sessions. */
+	std::chrono::steady_clock::time_point start_; /**< Time zero of the record timestamps. */
+	std::atomic<uint64_t> records_{ 0 };   /**< Frames recorded. */
+};
+
+/**
+ * @struct CapturedFrame
+ * @brief One record read back from a trace.
+ */
+struct CapturedFrame
+{
+	std::chrono::nanoseconds timestamp{ 0 }; /**< Time since capture start. */
+	SessionHandle session;                   /**< Sender at capture time. */
+	uint16_t opcode = NONE;                  /**< Frame opcode. */
+	FrameFlags flags = FrameFlags::None;     /**< Frame flags. */
+	BufferSlice payload;                     /**< Decrypted payload in a pooled buffer. */
+};
+
+/**
+ * @class PacketCaptureReader
+ * @brief Sequential reader of a PacketCapture trace.
+ */
+class PacketCaptureReader
+{
+public:
+	static constexpr uint32_t maxRecordLength = 16 * 1024 * 1024; /**< Longer records are treated as corruption. */
+
+	/**
+	 * @brief Open a trace and validate its header.
+	 * @param path Trace file.
+	 * @param pool Pool that payload buffers are drawn from.
+	 */
+	explicit PacketCaptureReader(const std::string& path, BufferPool& pool = BufferPool::shared())
+		: file_(path, std::ios::binary | std::ios::in),
+		pool_(pool)
+	{
+		if(!file_)
+			throw std::runtime_error("Failed to open capture file: " + path);
+		if(!file_.read(reinterpret_cast<char*>(&header_), sizeof(header_))
+		   || std::memcmp(header_.magic, CaptureFileHeader::expectedMagic, sizeof(header_.magic)) != 0
+		   || header_.version != CaptureFileHeader::currentVersion
+		   || header_.recordSize < sizeof(CaptureRecordHeader))
+			throw std::runtime_error("Not a supported capture file: " + path);
+	}
+
+	/**
+	 * @brief Header of the open trace.
+	 */
+	const CaptureFileHeader& header() const { return header_; }
+
+	/**
+	 * @brief Read the next record.
+	 * @return False at the end of the trace or at a truncated or corrupt record.
+	 */
+	bool next(CapturedFrame& frame)
+	{
+		CaptureRecordHeader record{};
+		if(!file_.read(reinterpret_cast<char*>(&record), sizeof(record))) return false;
+		if(record.length > maxRecordLength) return false;
+		if(header_.recordSize > sizeof(record))
+			file_.ignore(header_.recordSize - sizeof(record));
+
+		PooledBuffer buffer = pool_.acquire(record.length);
+		if(record.length && !file_.read(reinterpret_cast<char*>(buffer.data()), record.length)) return false;
+
+		frame.timestamp = std::chrono::nanoseconds(record.timestamp);
+		frame.session = SessionHandle::fromValue(record.session);
+		frame.opcode = record.opcode;
+		frame.flags = static_cast<FrameFlags>(record.flags);
+		frame.payload = BufferSlice(std::move(buffer), 0, record.length);
+		return true;
+	}
+
+private:
+	std::ifstream file_;           /**< Trace file. */
+	BufferPool& pool_;             /**< Source of payload buffers. */
+	CaptureFileHeader header_{};   /**< Validated file header. */
+};
@@ -5,25 +5,59 @@
  * @brief Maps opcode handlers for client or server usage.
  */
 
+#include <cstdint>
 #include <functional>
-#include <unordered_map>
+#include <span>
 #include <vector>
 
+/**
+ * @struct PacketRoute
+ * @brief Compile-time binding of an opcode to a free function or static member.
+ *
+ * Routes given to PacketDispatcher are resolved with a fold over plain comparisons
+ * and called directly, so hot opcodes skip the table and std::function entirely.
+ *
+ * @code
+ * void onMove(ClientSession& session, std::span<const uint8_t> payload);
+ * PacketDispatcher<ClientSession, PacketRoute<MOVE, &onMove>> dispatcher;
+ * @endcode
+ *
+ * @tparam Opcode Opcode handled by this route.
+ * @tparam Fn Function callable as Fn(T&, std::span<const uint8_t>).
+ */
+template <uint16_t Opcode, auto Fn>
+struct PacketRoute
+{
+	static constexpr uint16_t opcode = Opcode; /**< Routed opcode. */
+
+	template <typename T>
+	static void invoke(T& session, std::span<const uint8_t> payload)
+	{
+		Fn(session, payload);
+	}
+};
+
 /**
  * @class PacketDispatcher
- * @brief Dispatches Flatbuffers packets to handlers based on opcode.
+ * @brief Dispatches packets to handlers based on opcode.
+ *
+ * Compile-time Routes are checked first; everything else goes through a flat table
+ * indexed by opcode. The session is passed by reference, so dispatching costs no
+ * refcount traffic; handlers that need to keep it can call shared_from_this().
+ *
  * @tparam T The session type.
+ * @tparam Routes PacketRoute instantiations for opcodes known at compile time.
  */
-template <typename T>
+template <typename T, typename... Routes>
 class PacketDispatcher
 {
 public:
 	/**
 	 * @brief Type alias for handler function.
-	 * @param session Shared pointer to the session.
-	 * @param payload Flatbuffers payload bytes.
+	 * @param session The session the packet came from.
+	 * @param payload Decrypted payload bytes.
 	 */
-	using Handler = std::function<void(std::shared_ptr<T>, const std::vector<uint8_t>&)>;
+	using Handler = std::function<void(T&, std::span<const uint8_t>)>;
 
 	/**
 	 * @brief Register a handler for an opcode.
@@ -32,24 +66,37 @@ public:
 	 */
 	void registerHandler(uint16_t opcode, Handler handler)
 	{
-		handlers_[opcode] = handler;
+		if(opcode >= handlers_.size()) handlers_.resize(static_cast<size_t>(opcode) + 1);
+		handlers_[opcode] = std::move(handler);
 	}
 
 	/**
 	 * @brief Dispatch a payload to the correct handler.
 	 * @param session The source session.
-	 * @param opcode Opcode from Flatbuffers.
+	 * @param opcode Packet opcode.
 	 * @param payload Raw bytes.
+	 * @return True if a handler ran.
 	 */
-	void dispatch(std::shared_ptr<T> session, uint16_t opcode, const std::vector<uint8_t>& payload)
+	bool dispatch(T& session, uint16_t opcode, std::span<const uint8_t> payload) const
 	{
-		auto it = handlers_.find(opcode);
-		if(it != handlers_.end())
+		if((dispatchRoute<Routes>(session, opcode, payload) || ...)) return true;
+
+		if(opcode < handlers_.size() && handlers_[opcode])
 		{
-			it->second(session, payload);
+			handlers_[opcode](session, payload);
+			return true;
 		}
+		return false;
 	}
 
 private:
-	std::unordered_map<uint16_t, Handler> handlers_; /**< Registered handlers. */
+	template <typename Route>
+	static bool dispatchRoute(T& session, uint16_t opcode, std::span<const uint8_t> payload)
+	{
+		if(opcode != Route::opcode) return false;
+		Route::invoke(session, payload);
+		return true;
+	}
+
+	std::vector<Handler> handlers_; /**< Runtime handlers, indexed by opcode. */
 };
@@ -0,0 +1,99 @@
+#pragma once
+
+/**
+ * @file PacketReplay.hpp
+ * @brief Feeds a PacketCapture trace to a game loop as GameEvents, without sockets.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include "GameEvent.hpp"
+#include "PacketCapture.hpp"
+#include "ThreadSafeQueue.hpp"
+
+/**
+ * @struct ReplayStats
+ * @brief Outcome of PacketReplay::run().
+ */
+struct ReplayStats
+{
+	uint64_t events = 0;                     /**< Events delivered. */
+	std::chrono::nanoseconds captured{ 0 };  /**< Timestamp of the last event, i.e. the captured duration. */
+	std::chrono::nanoseconds elapsed{ 0 };   /**< Wall time of the replay. */
+	std::chrono::nanoseconds maxLag{ 0 };    /**< Largest delay behind schedule; 0 at max speed. */
+};
+
+/**
+ * @class PacketReplay
+ * @brief Turns every record of a trace back into the GameEvent the session queued for it.
+ *
+ * At speed 1 events are delivered at their original offsets from the start of the
+ * capture, at speed 2 twice as fast, and at speed 0 as fast as the sink accepts them.
+ * Session handles are the captured ones; they are consistent within the trace but do not
+ * resolve in any live SessionRegistry, so replies from handlers go nowhere. A session's
+ * last event is the SESSION_CLOSED it queued on close, as in the live server.
+ *
+ * @code
+ * PacketReplay replay("server.rwpc");
+ * ReplayStats stats = replay.run(events, 0.0);
+ * @endcode
+ */
+class PacketReplay
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Open a trace.
+	 * @param path Trace written by PacketCapture.
+	 */
+	explicit PacketReplay(const std::string& path)
+		: reader_(path)
+	{
+	}
+
+	/**
+	 * @brief Push every event into a game loop queue.
+	 * @param queue Queue the game loop pops from.
+	 * @param speed Multiple of the original pace; 0 means no pacing.
+	 */
+	ReplayStats run(ThreadSafeQueue<GameEvent>& queue, double speed = 1.0)
+	{
+		return run([&queue](GameEvent&& event) { queue.push(std::move(event)); }, speed);
+	}
+
+	/**
+	 * @brief Hand every event to a callable on the calling thread, e.g. a dispatcher.
+	 * @param sink Called with each GameEvent&& in trace order.
+	 * @param speed Multiple of the original pace; 0 means no pacing.
+	 */
+	template<typename Sink>
+	ReplayStats run(Sink&& sink, double speed = 1.0)
+	{
+		ReplayStats stats;
+		const auto start = Clock::now();
+		CapturedFrame frame;
+		while(reader_.next(frame))
+		{
+			if(speed > 0.0)
+			{
+				const auto due = start + std::chrono::duration_cast<Clock::duration>(frame.timestamp / speed);
+				const auto now = Clock::now();
+				if(due > now) std::this_thread::sleep_until(due);
+				else stats.maxLag = std::max(stats.maxLag, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due));
+			}
+
+			sink(GameEvent{ static_cast<Opcode>(frame.opcode), frame.session, std::move(frame.payload), {} });
+			++stats.events;
+			stats.captured = frame.timestamp;
+		}
+		stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+		return stats;
+	}
+
+private:
+	PacketCaptureReader reader_; /**< Open trace. */
+};
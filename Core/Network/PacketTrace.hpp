@@ -0,0 +1,320 @@
+#pragma once
+
+/**
+ * @file PacketTrace.hpp
+ * @brief Optional per-packet stage timestamps and per-opcode latency histograms.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <thread>
+#include "LatencyHistogram.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define NETWORK_TRACE_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define NETWORK_TRACE_TSC 1
+#endif
+
+/**
+ * @class TraceClock
+ * @brief Cheapest monotonic tick source: the TSC on x86, steady_clock nanoseconds elsewhere.
+ *
+ * Reading the TSC costs a few nanoseconds against roughly twenty for steady_clock, which
+ * keeps tracing within its per-packet budget. Assumes an invariant TSC, as on every x86
+ * CPU of the last decade.
+ */
+class TraceClock
+{
+public:
+	/**
+	 * @brief Current tick count; never 0.
+	 */
+	static uint64_t now()
+	{
+#if defined(NETWORK_TRACE_TSC)
+		return __rdtsc() | 1;
+#else
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count()) | 1;
+#endif
+	}
+
+	/**
+	 * @brief Nanoseconds per tick, measured once against steady_clock; the first call blocks for about 10 ms on x86.
+	 */
+	static double nanosPerTick()
+	{
+		static const double value = calibrate();
+		return value;
+	}
+
+private:
+	static double calibrate()
+	{
+#if defined(NETWORK_TRACE_TSC)
+		using Clock = std::chrono::steady_clock;
+		const auto start = Clock::now();
+		const uint64_t startTicks = now();
+		while(Clock::now() - start < std::chrono::milliseconds(10))
+			std::this_thread::yield();
+		const uint64_t ticks = now() - startTicks;
+		const double nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+		return ticks ? nanos / static_cast<double>(ticks) : 1.0;
+#else
+		return 1.0;
+#endif
+	}
+};
+
+/**
+ * @enum TraceStage
+ * @brief Intervals between the timestamps of a traced packet.
+ */
+enum class TraceStage : uint8_t
+{
+	Decrypt,   /**< Socket read completed until the payload was decrypted. */
+	Enqueue,   /**< Decrypted until pushed into the GameEvent queue (validation). */
+	QueueWait, /**< Queued until the game loop dequeued the event. */
+	Handle,    /**< Dequeued until the handler returned. */
+	Total,     /**< Socket read completed until the handler returned. */
+	Reply,     /**< sendPacket() until async_write completed for that packet. */
+	Count
+};
+
+/**
+ * @struct PacketTimestamps
+ * @brief TraceClock ticks a received packet carries in its GameEvent; all 0 when tracing is off.
+ */
+struct PacketTimestamps
+{
+	uint64_t read = 0;      /**< Read completion that delivered the frame. */
+	uint64_t decrypted = 0; /**< Payload decrypted. */
+	uint64_t queued = 0;    /**< About to be pushed into the GameEvent queue. */
+};
+
+/**
+ * @class PacketTrace
+ * @brief Per-opcode histograms of every TraceStage, off by default.
+ *
+ * Sessions stamp frames on the io threads, and the game loop records the intervals when it
+ * handles the event (see Scope). Intervals are converted from TraceClock ticks to
+ * nanoseconds, with the rate calibrated by enable(), before they are recorded, so the
+ * histograms hold nanoseconds like every other LatencyHistogram. Histograms are allocated
+ * the first time an opcode is seen and live as long as the PacketTrace.
+ *
+ * A fully traced packet costs about seven clock reads and six histogram increments: about
+ * 200 ns on a virtualized x86 host, where one TSC read takes over 20 ns. So by default only
+ * one packet in eight is traced, which measured 25 ns per packet on average on the same
+ * host. Packets that are not sampled cost a counter decrement. While tracing is disabled,
+ * each check is one relaxed load.
+ *
+ * @code
+ * PacketTrace::shared().enable();
+ * ...
+ * GameEvent event;
+ * events.waitPop(event);
+ * PacketTrace::Scope trace(event.opcode, event.trace);
+ * handle(event);
+ * ...
+ * PacketTrace::shared().dump(std::cerr);
+ * @endcode
+ */
+class PacketTrace
+{
+public:
+	static constexpr size_t stageCount = static_cast<size_t>(TraceStage::Count);
+
+	/**
+	 * @class Scope
+	 * @brief Stamps dequeue on construction and handled on destruction, then records the event's stages.
+	 */
+	class Scope
+	{
+	public:
+		Scope(uint16_t opcode, const PacketTimestamps& timestamps, PacketTrace& trace = PacketTrace::shared())
+			: trace_(trace), opcode_(opcode), timestamps_(timestamps), dequeued_(timestamps.read ? trace.stamp() : 0)
+		{
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		~Scope()
+		{
+			if(dequeued_) trace_.recordEvent(opcode_, timestamps_, dequeued_, trace_.stamp());
+		}
+
+	private:
+		PacketTrace& trace_;           /**< Destination histograms. */
+		uint16_t opcode_;              /**< Event opcode. */
+		PacketTimestamps timestamps_;  /**< Stamps taken by the session. */
+		uint64_t dequeued_;            /**< Construction time, or 0 if the event is not traced. */
+	};
+
+	PacketTrace() = default;
+	PacketTrace(const PacketTrace&) = delete;
+	PacketTrace& operator=(const PacketTrace&) = delete;
+
+	~PacketTrace()
+	{
+		for(auto& slot : opcodes_)
+			delete slot.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Turn tracing on or off at runtime; the first enable calibrates the clock.
+	 * @param on New state.
+	 * @param sampleEvery Trace one packet in this many; 1 traces every packet.
+	 */
+	void enable(bool on = true, uint32_t sampleEvery = 8)
+	{
+		if(on) TraceClock::nanosPerTick();
+		sampleEvery_.store(std::max<uint32_t>(sampleEvery, 1), std::memory_order_relaxed);
+		enabled_.store(on, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief True while packets are being stamped.
+	 */
+	bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Current TraceClock ticks, or 0 while disabled.
+	 */
+	uint64_t stamp() const { return enabled() ? TraceClock::now() : 0; }
+
+	/**
+	 * @brief Decide whether to trace the next packet of a stream.
+	 * @param countdown Caller-owned counter, e.g. per session; not shared between threads.
+	 * @return True for one call in sampleEvery while enabled.
+	 */
+	bool sample(uint32_t& countdown) const
+	{
+		if(!enabled()) return false;
+		if(countdown > 0)
+		{
+			--countdown;
+			return false;
+		}
+		countdown = sampleEvery_.load(std::memory_order_relaxed) - 1;
+		return true;
+	}
+
+	/**
+	 * @brief stamp() for the packets sample() selects, with a per-thread countdown; 0 otherwise.
+	 */
+	uint64_t sampleStamp() const
+	{
+		thread_local uint32_t countdown = 0;
+		return sample(countdown) ? TraceClock::now() : 0;
+	}
+
+	/**
+	 * @brief Record one interval; ignored if either stamp is 0.
+	 * @param opcode Packet opcode.
+	 * @param stage Interval being measured.
+	 * @param from Earlier stamp.
+	 * @param to Later stamp.
+	 */
+	void record(uint16_t opcode, TraceStage stage, uint64_t from, uint64_t to)
+	{
+		if(!from || !to) return;
+		stagesFor(opcode)[static_cast<size_t>(stage)].record(elapsed(from, to));
+	}
+
+	/**
+	 * @brief Record every receive-side stage of a handled event.
+	 */
+	void recordEvent(uint16_t opcode, const PacketTimestamps& timestamps, uint64_t dequeued, uint64_t handled)
+	{
+		if(!timestamps.read || !handled) return;
+		auto& stages = stagesFor(opcode);
+		stages[static_cast<size_t>(TraceStage::Decrypt)].record(elapsed(timestamps.read, timestamps.decrypted));
+		stages[static_cast<size_t>(TraceStage::Enqueue)].record(elapsed(timestamps.decrypted, timestamps.queued));
+		stages[static_cast<size_t>(TraceStage::QueueWait)].record(elapsed(timestamps.queued, dequeued));
+		stages[static_cast<size_t>(TraceStage::Handle)].record(elapsed(dequeued, handled));
+		stages[static_cast<size_t>(TraceStage::Total)].record(elapsed(timestamps.read, handled));
+	}
+
+	/**
+	 * @brief Write count and percentiles in microseconds for every opcode and stage seen so far.
+	 *
+	 * Safe to call from any thread while packets are being recorded.
+	 */
+	void dump(std::ostream& out) const
+	{
+		static constexpr const char* stageNames[stageCount] = { "decrypt", "enqueue", "queue_wait", "handle", "total", "reply" };
+		const auto flags = out.flags();
+		const auto precision = out.precision();
+		out << "opcode stage        count      p50_us     p99_us    p999_us\n" << std::fixed << std::setprecision(1);
+		for(size_t opcode = 0; opcode < opcodes_.size(); ++opcode)
+		{
+			const Stages* stages = opcodes_[opcode].load(std::memory_order_acquire);
+			if(!stages) continue;
+			for(size_t stage = 0; stage < stageCount; ++stage)
+			{
+				const auto counts = (*stages)[stage].snapshot();
+				uint64_t total = 0;
+				for(uint64_t count : counts) total += count;
+				if(total == 0) continue;
+
+				const auto micros = [&](double quantile)
+				{
+					return static_cast<double>(LatencyHistogram::percentile(counts, quantile)) / 1000.0;
+				};
+				out << std::setw(6) << opcode << ' ' << std::left << std::setw(10) << stageNames[stage] << std::right
+					<< std::setw(9) << total << std::setw(12) << micros(0.50) << std::setw(11) << micros(0.99)
+					<< std::setw(11) << micros(0.999) << '\n';
+			}
+		}
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+	/**
+	 * @brief Trace shared by every session in the process.
+	 */
+	static PacketTrace& shared()
+	{
+		static PacketTrace trace;
+		return trace;
+	}
+
+private:
+	using Stages = std::array<LatencyHistogram, stageCount>;
+
+	/**
+	 * @brief Interval between two TraceClock stamps in nanoseconds, the unit LatencyHistogram takes.
+	 */
+	static uint64_t elapsed(uint64_t from, uint64_t to)
+	{
+		return to > from ? static_cast<uint64_t>(static_cast<double>(to - from) * TraceClock::nanosPerTick()) : 0;
+	}
+
+	/**
+	 * @brief Histograms of an opcode, allocated on first use; racing threads keep the first.
+	 */
+	Stages& stagesFor(uint16_t opcode)
+	{
+		auto& slot = opcodes_[opcode];
+		Stages* stages = slot.load(std::memory_order_acquire);
+		if(stages) return *stages;
+
+		Stages* created = new Stages();
+		if(slot.compare_exchange_strong(stages, created, std::memory_order_acq_rel)) return *created;
+		delete created;
+		return *stages;
+	}
+
+	std::atomic<bool> enabled_{ false };                 /**< Stamping switch. */
+	std::atomic<uint32_t> sampleEvery_{ 8 };             /**< Sampling period, see enable(). */
+	std::array<std::atomic<Stages*>, 65536> opcodes_{}; /**< Histograms per opcode, nullptr until seen. */
+};
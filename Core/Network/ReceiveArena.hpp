@@ -0,0 +1,216 @@
+#pragma once
+
+/**
+ * @file ReceiveArena.hpp
+ * @brief Per-io_context slab of session receive buffers, registered with io_uring when available.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "AsioConfig.hpp"
+
+/**
+ * @class ReceiveArena
+ * @brief Fixed number of equally sized receive buffers carved from one allocation.
+ *
+ * With the io_uring backend (NETWORK_HAS_IO_URING) every slot is registered with the
+ * context's ring once at construction. Reads into a slot then use IORING_OP_READ_FIXED, so
+ * the kernel does not map and pin the pages on every receive. If registration fails, for
+ * example because another arena already registered buffers with the same context or the
+ * memlock limit is too low, the slots still work as ordinary memory.
+ *
+ * Create the arena with std::make_shared. A Slot keeps its arena alive, so sessions that
+ * are only released when their io_context is destroyed can outlive it too; call
+ * unregister() while the context still exists so that nothing touches its ring later.
+ * Server does this in its destructor.
+ */
+class ReceiveArena : public std::enable_shared_from_this<ReceiveArena>
+{
+public:
+	/** Upper bound on slots per arena; the kernel limit for registered buffers per ring. */
+	static constexpr size_t maxSlots = 16 * 1024;
+
+	/**
+	 * @class Slot
+	 * @brief Move-only lease on one buffer; returns it to the arena on destruction.
+	 */
+	class Slot
+	{
+	public:
+		Slot() = default;
+		Slot(Slot&& other) noexcept
+			: arena_(std::move(other.arena_)), index_(other.index_)
+		{
+		}
+
+		Slot& operator=(Slot&& other) noexcept
+		{
+			if(this != &other)
+			{
+				reset();
+				arena_ = std::move(other.arena_);
+				index_ = other.index_;
+			}
+			return *this;
+		}
+
+		~Slot() { reset(); }
+
+		/**
+		 * @brief True if the slot holds a buffer.
+		 */
+		explicit operator bool() const { return arena_ != nullptr; }
+
+		/**
+		 * @brief First byte of the buffer.
+		 */
+		uint8_t* data() const { return arena_ ? arena_->slotData(index_) : nullptr; }
+
+		/**
+		 * @brief Buffer size in bytes.
+		 */
+		size_t size() const { return arena_ ? arena_->slotSize_ : 0; }
+
+		/**
+		 * @brief True if reads into this slot can use the registered buffer.
+		 */
+		bool registered() const { return arena_ && arena_->registered(); }
+
+#if defined(NETWORK_HAS_IO_URING)
+		/**
+		 * @brief Registered view of the whole slot; only valid if registered().
+		 */
+		const asio::mutable_registered_buffer& registeredBuffer() const { return (*arena_->registration_)[index_]; }
+#endif
+
+	private:
+		friend class ReceiveArena;
+
+		Slot(std::shared_ptr<ReceiveArena> arena, size_t index)
+			: arena_(std::move(arena)), index_(index)
+		{
+		}
+
+		void reset()
+		{
+			if(arena_) arena_->release(index_);
+			arena_.reset();
+		}
+
+		std::shared_ptr<ReceiveArena> arena_; /**< Owner, or nullptr if empty. */
+		size_t index_ = 0;                    /**< Slot number within the arena. */
+	};
+
+	/**
+	 * @brief Allocate the slots and register them with the context's ring if supported.
+	 * @param context Context whose sockets will read into the slots.
+	 * @param slotSize Bytes per slot.
+	 * @param slotCount Number of slots; clamped to maxSlots.
+	 */
+	ReceiveArena(asio::io_context& context, size_t slotSize, size_t slotCount)
+		: context_(context),
+		slotSize_(slotSize),
+		slotCount_(std::min(slotCount, maxSlots)),
+		storage_(new uint8_t[slotSize_ * slotCount_])
+	{
+		free_.reserve(slotCount_);
+		for(size_t i = slotCount_; i-- > 0;)
+			free_.push_back(i);
+
+#if defined(NETWORK_HAS_IO_URING)
+		std::vector<asio::mutable_buffer> buffers;
+		buffers.reserve(slotCount_);
+		for(size_t i = 0; i < slotCount_; ++i)
+			buffers.push_back(asio::buffer(slotData(i), slotSize_));
+
+		try
+		{
+			registration_.emplace(asio::register_buffers(context, buffers));
+		}
+		catch(const std::exception&)
+		{
+			// Not registered: slots behave like ordinary buffers
+		}
+#endif
+	}
+
+	ReceiveArena(const ReceiveArena&) = delete;
+	ReceiveArena& operator=(const ReceiveArena&) = delete;
+
+	/**
+	 * @brief Lease a free slot.
+	 * @return Empty slot if the arena is exhausted.
+	 */
+	Slot acquire()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(free_.empty()) return Slot();
+		const size_t index = free_.back();
+		free_.pop_back();
+		return Slot(shared_from_this(), index);
+	}
+
+	/**
+	 * @brief True if this arena's slots are meant for sockets of the given context.
+	 */
+	bool serves(const asio::execution_context& context) const
+	{
+		return &context == &static_cast<const asio::execution_context&>(context_);
+	}
+
+	/**
+	 * @brief Release the io_uring registration; the slots keep working as ordinary buffers.
+	 *
+	 * The registration is released through the context's ring, so call this before the
+	 * context is destroyed and while no thread is running it. Idempotent.
+	 */
+	void unregister()
+	{
+#if defined(NETWORK_HAS_IO_URING)
+		registration_.reset();
+#endif
+	}
+
+	/**
+	 * @brief Bytes per slot.
+	 */
+	size_t slotSize() const { return slotSize_; }
+
+	/**
+	 * @brief True if the slots are registered with io_uring.
+	 */
+	bool registered() const
+	{
+#if defined(NETWORK_HAS_IO_URING)
+		return registration_.has_value();
+#else
+		return false;
+#endif
+	}
+
+private:
+	uint8_t* slotData(size_t index) const { return storage_.get() + index * slotSize_; }
+
+	void release(size_t index)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		free_.push_back(index);
+	}
+
+	asio::io_context& context_;          /**< Context the slots are registered with. */
+	const size_t slotSize_;              /**< Bytes per slot. */
+	const size_t slotCount_;             /**< Number of slots. */
+	std::unique_ptr<uint8_t[]> storage_; /**< All slots, contiguous. */
+	std::vector<size_t> free_;           /**< Indices of free slots. */
+	std::mutex mutex_;                   /**< Guards free_. */
+#if defined(NETWORK_HAS_IO_URING)
+	std::optional<asio::buffer_registration<std::vector<asio::mutable_buffer>>> registration_; /**< io_uring registration of all slots. */
+#endif
+};
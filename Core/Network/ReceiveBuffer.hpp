@@ -0,0 +1,131 @@
+#pragma once
+
+/**
+ * @file ReceiveBuffer.hpp
+ * @brief Per-session receive buffer that collects stream bytes and yields whole frames.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include "BufferPool.hpp"
+#include "ReceiveArena.hpp"
+
+/**
+ * @class ReceiveBuffer
+ * @brief Fixed-capacity byte buffer for batched socket reads.
+ *
+ * Reads append at the tail, complete frames are consumed from the head. Instead of
+ * wrapping around, the unread remainder (at most one partial frame) is moved back to
+ * the front by compact(), so every frame handed to the decryptor is contiguous. A frame
+ * larger than the capacity never completes here; the owner moves it out instead.
+ */
+class ReceiveBuffer
+{
+public:
+	/**
+	 * @brief Takes the buffer from a pool once for the session's lifetime.
+	 * @param capacity Total bytes; at least one frame header. 0 leaves the buffer unallocated.
+	 * @param pool Pool the storage is drawn from and returned to.
+	 */
+	explicit ReceiveBuffer(size_t capacity, BufferPool& pool = BufferPool::shared())
+		: buffer_(capacity ? pool.acquire(capacity) : PooledBuffer()),
+		data_(buffer_.data()),
+		capacity_(capacity)
+	{
+	}
+
+	/**
+	 * @brief Leases a slot of an arena, falling back to the shared BufferPool if none is free or big enough.
+	 * @param capacity Total bytes; at least one frame header.
+	 * @param arena Arena of the session's io_context.
+	 */
+	ReceiveBuffer(size_t capacity, ReceiveArena& arena)
+		: ReceiveBuffer(capacity <= arena.slotSize() ? arena.acquire() : ReceiveArena::Slot(), capacity)
+	{
+	}
+
+	/**
+	 * @brief True if reads should target registeredWritable() instead of writePtr().
+	 */
+	bool registered() const { return slot_.registered(); }
+
+#if defined(NETWORK_HAS_IO_URING)
+	/**
+	 * @brief Registered view of the free space after the tail; only valid if registered().
+	 */
+	asio::mutable_registered_buffer registeredWritable() const
+	{
+		return asio::buffer(slot_.registeredBuffer() + tail_, writableSize());
+	}
+#endif
+
+	/**
+	 * @brief Where the next read should write.
+	 */
+	uint8_t* writePtr() { return data_ + tail_; }
+
+	/**
+	 * @brief Free space after the tail.
+	 */
+	size_t writableSize() const { return capacity_ - tail_; }
+
+	/**
+	 * @brief Mark bytes written by a read as available.
+	 * @param size Bytes received.
+	 */
+	void commit(size_t size) { tail_ += size; }
+
+	/**
+	 * @brief First unread byte.
+	 */
+	const uint8_t* readPtr() const { return data_ + head_; }
+
+	/**
+	 * @brief Number of unread bytes.
+	 */
+	size_t readableSize() const { return tail_ - head_; }
+
+	/**
+	 * @brief Drop bytes from the head after they have been handled.
+	 * @param size Bytes to drop.
+	 */
+	void consume(size_t size)
+	{
+		head_ += size;
+		if(head_ == tail_) head_ = tail_ = 0;
+	}
+
+	/**
+	 * @brief Move the unread remainder to the front to make room at the tail.
+	 */
+	void compact()
+	{
+		if(head_ == 0) return;
+		const size_t remaining = readableSize();
+		std::memmove(data_, data_ + head_, remaining);
+		head_ = 0;
+		tail_ = remaining;
+	}
+
+	/**
+	 * @brief Total capacity in bytes.
+	 */
+	size_t capacity() const { return capacity_; }
+
+private:
+	ReceiveBuffer(ReceiveArena::Slot slot, size_t capacity)
+		: ReceiveBuffer(slot ? 0 : capacity)
+	{
+		if(!slot) return;
+		slot_ = std::move(slot);
+		data_ = slot_.data();
+		capacity_ = capacity;
+	}
+
+	ReceiveArena::Slot slot_;     /**< Backing storage when leased from a ReceiveArena. */
+	PooledBuffer buffer_;         /**< Backing storage otherwise, acquired once. */
+	uint8_t* data_ = nullptr;     /**< Start of whichever storage is in use. */
+	size_t capacity_ = 0;         /**< Usable bytes of the storage. */
+	size_t head_ = 0;             /**< Offset of the first unread byte. */
+	size_t tail_ = 0;             /**< Offset one past the last received byte. */
+};
@@ -2,21 +2,47 @@
 
 /**
  * @file Server.hpp
- * @brief Simple TCP server accepting multiple ClientSessions.
+ * @brief TCP server accepting ClientSessions on one io_context or a pool of them.
  */
 
-#include <asio.hpp>
+#include "AsioConfig.hpp"
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
+#include "BufferPool.hpp"
 #include "ClientSession.hpp"
 #include "Crypto.hpp"
 #include "ThreadSafeQueue.hpp"
 #include "GameEvent.hpp"
+#include "IoContextPool.hpp"
+#include "NetworkMetrics.hpp"
+#include "ReceiveArena.hpp"
+#include "SessionOptions.hpp"
+#include "SessionPool.hpp"
+#include "SessionRegistry.hpp"
+#include "SocketOptions.hpp"
+#include "TokenBucket.hpp"
 
 using asio::ip::tcp;
 
+/**
+ * @enum AcceptMode
+ * @brief How a multi-context Server spreads new connections over its IoContextPool.
+ */
+enum class AcceptMode
+{
+	RoundRobin, /**< One acceptor; accepted sockets are assigned to contexts in turn. */
+	ReusePort   /**< One SO_REUSEPORT acceptor per context; the kernel balances connections. Linux only, falls back to RoundRobin elsewhere. */
+};
+
 /**
  * @class Server
  * @brief Accepts incoming TCP connections and creates ClientSessions.
+ *
+ * Admission is controlled at the acceptor (see ServerOptions): when the accept rate limit
+ * is exhausted the acceptor pauses and leaves connections in the kernel backlog; when the
+ * session or pending-handshake cap is reached, accepted sockets are closed immediately.
  */
 class Server
 {
@@ -25,38 +51,240 @@ public:
 	 * @brief Starts server listening on specified port.
 	 * @param ioContext asio IO context.
 	 * @param port TCP port to listen.
-	 * @param crypto AES crypto helper.
+	 * @param crypto Crypto template copied into each session, which derives its own keys from it; its CipherMode selects CBC or AEAD.
 	 * @param eventQueue Event queue to pass GameEvents.
+	 * @param sessionOptions I/O configuration applied to every accepted session.
+	 * @param serverOptions Admission limits and startup pre-allocation.
 	 */
 	Server(asio::io_context& ioContext,
 		   uint16_t port,
 		   Crypto crypto,
-		   ThreadSafeQueue<GameEvent>& eventQueue)
-		: acceptor_(ioContext, tcp::endpoint(tcp::v4(), port)),
+		   ThreadSafeQueue<GameEvent>& eventQueue,
+		   const SessionOptions& sessionOptions = {},
+		   const ServerOptions& serverOptions = {})
+		: crypto_(crypto),
+		eventQueue_(eventQueue),
+		sessionOptions_(sessionOptions),
+		serverOptions_(serverOptions),
+		acceptRate_(serverOptions.acceptRatePerSecond, serverOptions.acceptBurst),
+		sessionPool_(serverOptions.preallocatedSessions)
+	{
+		preallocate({ &ioContext });
+		acceptors_.emplace_back(ioContext, tcp::endpoint(tcp::v4(), port));
+		sessionOptions_.socketOptions.applyToListener(acceptors_.back());
+		acceptTimers_.emplace_back(ioContext);
+		doAccept(0);
+	}
+
+	/**
+	 * @brief Starts server listening on specified port, serving sessions from every context of a pool.
+	 * @param pool Contexts to run sessions on; the caller runs it and must stop it before destroying the Server.
+	 * @param port TCP port to listen.
+	 * @param crypto Crypto template copied into each session, which derives its own keys from it; its CipherMode selects CBC or AEAD.
+	 * @param eventQueue Event queue to pass GameEvents.
+	 * @param sessionOptions I/O configuration applied to every accepted session.
+	 * @param mode How connections are distributed over the pool.
+	 * @param serverOptions Admission limits and startup pre-allocation.
+	 */
+	Server(IoContextPool& pool,
+		   uint16_t port,
+		   Crypto crypto,
+		   ThreadSafeQueue<GameEvent>& eventQueue,
+		   const SessionOptions& sessionOptions = {},
+		   AcceptMode mode = AcceptMode::ReusePort,
+		   const ServerOptions& serverOptions = {})
+		: pool_(&pool),
 		crypto_(crypto),
-		eventQueue_(eventQueue)
+		eventQueue_(eventQueue),
+		sessionOptions_(sessionOptions),
+		serverOptions_(serverOptions),
+		acceptRate_(serverOptions.acceptRatePerSecond, serverOptions.acceptBurst),
+		sessionPool_(serverOptions.preallocatedSessions)
+	{
+		std::vector<asio::io_context*> contexts;
+		for(size_t i = 0; i < pool.size(); ++i)
+			contexts.push_back(&pool.at(i));
+		preallocate(contexts);
+#if !defined(SO_REUSEPORT)
+		mode = AcceptMode::RoundRobin;
+#endif
+		const tcp::endpoint endpoint(tcp::v4(), port);
+		if(mode == AcceptMode::RoundRobin)
+		{
+			acceptors_.emplace_back(pool.at(0), endpoint);
+			sessionOptions_.socketOptions.applyToListener(acceptors_.back());
+		}
+		else
+		{
+			acceptors_.reserve(pool.size());
+			for(size_t i = 0; i < pool.size(); ++i)
+			{
+				tcp::acceptor& acceptor = acceptors_.emplace_back(pool.at(i));
+				acceptor.open(endpoint.protocol());
+				acceptor.set_option(tcp::acceptor::reuse_address(true));
+#if defined(SO_REUSEPORT)
+				acceptor.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#endif
+				sessionOptions_.socketOptions.applyToListener(acceptor);
+				acceptor.bind(endpoint);
+				acceptor.listen();
+			}
+		}
+		roundRobin_ = mode == AcceptMode::RoundRobin;
+
+		acceptTimers_.reserve(acceptors_.size());
+		for(size_t i = 0; i < acceptors_.size(); ++i)
+		{
+			acceptTimers_.emplace_back(acceptors_[i].get_executor());
+			doAccept(i);
+		}
+	}
+
+	/**
+	 * @brief Releases the receive arenas' io_uring registrations.
+	 *
+	 * Destroy the Server after its contexts are stopped and before they are destroyed, as
+	 * with any object whose handlers they run. Sessions still referenced by pending handlers,
+	 * and the arenas their buffers keep alive, are then freed with the contexts and no longer
+	 * touch a ring.
+	 */
+	~Server()
 	{
-		doAccept();
+		for(const auto& arena : receiveArenas_)
+			arena->unregister();
 	}
 
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+
+	/**
+	 * @brief Live sessions, for resolving GameEvent::session.
+	 */
+	SessionRegistry& sessions() { return sessions_; }
+
+	/**
+	 * @brief Sessions that have not sent a valid frame yet.
+	 */
+	size_t pendingHandshakes() const { return pendingHandshakes_.load(std::memory_order_relaxed); }
+
 private:
 	/**
-	 * @brief Accepts incoming connections asynchronously.
+	 * @brief Sizes the registry, session pool and receive buffers for the configured load up front.
+	 * @param contexts Contexts sessions will run on.
+	 *
+	 * With the io_uring backend each context gets a ReceiveArena registered with its ring;
+	 * otherwise receive buffers are drawn from the shared BufferPool.
+	 */
+	void preallocate(const std::vector<asio::io_context*>& contexts)
+	{
+		sessions_.reserve(serverOptions_.maxSessions);
+		if(sessionOptions_.readMode != ReadMode::Batched) return;
+
+		const size_t bufferSize = ClientSession::receiveBufferSize(sessionOptions_);
+#if defined(NETWORK_HAS_IO_URING)
+		const size_t perContext = (serverOptions_.preallocatedSessions + contexts.size() - 1) / contexts.size();
+		receiveArenas_.reserve(contexts.size());
+		for(asio::io_context* context : contexts)
+			receiveArenas_.push_back(std::make_shared<ReceiveArena>(*context, bufferSize, perContext));
+#else
+		(void)contexts;
+		BufferPool::shared().reserve(bufferSize, serverOptions_.preallocatedSessions);
+#endif
+	}
+
+	/**
+	 * @brief Arena serving the context a socket was accepted on.
+	 * @return nullptr if the context has none.
+	 */
+	ReceiveArena* arenaFor(tcp::socket& socket)
+	{
+		const asio::execution_context& context = asio::query(socket.get_executor(), asio::execution::context);
+		for(const auto& arena : receiveArenas_)
+			if(arena->serves(context)) return arena.get();
+		return nullptr;
+	}
+
+	/**
+	 * @brief Reserves a pending-handshake slot if the session and handshake caps allow another connection.
+	 */
+	bool admit()
+	{
+		if(sessions_.size() >= serverOptions_.maxSessions) return false;
+		if(pendingHandshakes_.fetch_add(1, std::memory_order_relaxed) >= serverOptions_.maxPendingHandshakes)
+		{
+			pendingHandshakes_.fetch_sub(1, std::memory_order_relaxed);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Accepts incoming connections asynchronously on one acceptor.
+	 * @param index Acceptor to accept on.
 	 */
-	void doAccept()
+	void doAccept(size_t index)
 	{
-		acceptor_.async_accept(
-			[this](std::error_code ec, tcp::socket socket)
+		// Out of accept tokens: leave connections in the backlog until the next one is due
+		TokenBucket::Clock::duration wait;
+		{
+			std::lock_guard<std::mutex> lock(acceptRateMutex_);
+			wait = acceptRate_.tryTake() ? TokenBucket::Clock::duration::zero() : acceptRate_.timeUntil();
+		}
+		if(wait > TokenBucket::Clock::duration::zero())
+		{
+			NetworkMetrics::bump(NetworkMetrics::shared().acceptPauses);
+			acceptTimers_[index].expires_after(wait);
+			acceptTimers_[index].async_wait([this, index](std::error_code ec)
+											{
+												if(ec || !acceptors_[index].is_open()) return;
+												doAccept(index);
+											});
+			return;
+		}
+
+		auto onAccept = [this, index](std::error_code ec, tcp::socket socket)
+		{
+			// Acceptor closed: stop instead of spinning on errors
+			if(ec && !acceptors_[index].is_open()) return;
+			if(!ec)
 			{
-				if(!ec)
+				if(admit())
+				{
+					// Best effort: unsupported or refused options leave the system default in place
+					sessionOptions_.socketOptions.apply(socket);
+					ReceiveArena* arena = arenaFor(socket);
+					auto session = sessionPool_.create(std::move(socket), crypto_, eventQueue_, sessionOptions_, arena);
+					session->trackHandshake(pendingHandshakes_);
+					session->registerIn(sessions_);
+					session->start();
+				}
+				else
 				{
-					std::make_shared<ClientSession>(std::move(socket), crypto_, eventQueue_)->start();
+					NetworkMetrics::bump(NetworkMetrics::shared().acceptsRejected);
+					asio::error_code ignored;
+					socket.close(ignored);
 				}
-				doAccept();
-			});
+			}
+			doAccept(index);
+		};
+
+		// Round-robin: the socket is created on the next pool context rather than the acceptor's
+		if(roundRobin_) acceptors_[index].async_accept(pool_->next(), onAccept);
+		else acceptors_[index].async_accept(onAccept);
 	}
 
-	tcp::acceptor acceptor_;               /**< Accepts TCP connections. */
-	Crypto crypto_;                        /**< AES crypto helper. */
+	IoContextPool* pool_ = nullptr;        /**< Session contexts, or nullptr in single-context mode. */
+	bool roundRobin_ = false;              /**< Hand accepted sockets to pool_->next(). */
+	std::vector<tcp::acceptor> acceptors_; /**< Accept TCP connections, one per context with SO_REUSEPORT. */
+	std::vector<asio::steady_timer> acceptTimers_; /**< Resume a throttled acceptor, one per acceptor. */
+	Crypto crypto_;                        /**< Shared secret and cipher copied into each session. */
 	ThreadSafeQueue<GameEvent>& eventQueue_; /**< Event queue for ECS/game loop. */
-};
+	SessionOptions sessionOptions_;        /**< Options handed to each ClientSession. */
+	ServerOptions serverOptions_;          /**< Admission limits. */
+	TokenBucket acceptRate_;               /**< Accept rate limit, shared by all acceptors. */
+	std::mutex acceptRateMutex_;           /**< Guards acceptRate_ across acceptor threads. */
+	std::atomic<size_t> pendingHandshakes_{ 0 }; /**< Sessions waiting for their first valid frame. */
+	SessionPool sessionPool_;              /**< Pre-allocated session storage. */
+	SessionRegistry sessions_;             /**< Sessions accepted by this server. */
+	std::vector<std::shared_ptr<ReceiveArena>> receiveArenas_; /**< Registered receive buffers, one per context (io_uring only). */
+};
\ No newline at end of file
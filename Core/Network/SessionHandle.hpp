@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * @file SessionHandle.hpp
+ * @brief Generational handle identifying a session without owning it.
+ */
+
+#include <cstdint>
+
+/**
+ * @struct SessionHandle
+ * @brief Slot index plus generation. A handle to a session that has since disconnected
+ * stops resolving once its slot is reused, instead of pinning the session in memory.
+ */
+struct SessionHandle
+{
+	uint32_t index = 0;      /**< Slot in the SessionRegistry. */
+	uint32_t generation = 0; /**< Slot generation at registration; 0 means invalid. */
+
+	/**
+	 * @brief True if the handle was ever issued by a registry.
+	 */
+	bool valid() const { return generation != 0; }
+
+	/**
+	 * @brief Packs the handle into one integer, e.g. for logs or trace files.
+	 */
+	uint64_t value() const { return (static_cast<uint64_t>(generation) << 32) | index; }
+
+	/**
+	 * @brief Rebuilds a handle from value().
+	 */
+	static SessionHandle fromValue(uint64_t value)
+	{
+		return SessionHandle{ static_cast<uint32_t>(value), static_cast<uint32_t>(value >> 32) };
+	}
+
+	friend bool operator==(const SessionHandle&, const SessionHandle&) = default;
+};
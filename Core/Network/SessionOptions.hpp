@@ -0,0 +1,127 @@
+#pragma once
+
+/**
+ * @file SessionOptions.hpp
+ * @brief Tunables shared by the Server and the ClientSessions it creates.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "SocketOptions.hpp"
+
+class PacketCapture;
+
+/**
+ * @enum ReadMode
+ * @brief How a session pulls frames off its socket.
+ */
+enum class ReadMode
+{
+	PerFrame, /**< One read for the length header, one for the body. */
+	Batched   /**< read_some into a ReceiveBuffer and parse every complete frame per completion. */
+};
+
+/**
+ * @enum RateClass
+ * @brief Opcode groups that get separate inbound rate limits; see InboundRateLimiter::classify().
+ */
+enum class RateClass : uint8_t
+{
+	Control,  /**< Session housekeeping: PING, LOGIN. */
+	Movement, /**< High-frequency state updates: MOVE. */
+	Game,     /**< Every other opcode. */
+	Count
+};
+
+/**
+ * @enum OverLimitAction
+ * @brief What a session does with an inbound frame over its rate limit.
+ */
+enum class OverLimitAction
+{
+	Skip, /**< Drop the frame without decrypting it and keep the session. */
+	Close /**< Close the session before decrypting anything. */
+};
+
+/**
+ * @struct RateLimit
+ * @brief Frame and byte token buckets for one RateClass; a rate of 0 disables that bucket.
+ */
+struct RateLimit
+{
+	double framesPerSecond = 0.0; /**< Sustained frames per second. */
+	double frameBurst = 0.0;      /**< Frames allowed back to back. */
+	double bytesPerSecond = 0.0;  /**< Sustained encrypted payload bytes per second. */
+	double byteBurst = 0.0;       /**< Bytes allowed back to back; raised to the largest frame if smaller. */
+};
+
+/**
+ * @struct InboundRateLimits
+ * @brief Per-session inbound limits, checked from the cleartext frame header before decryption.
+ */
+struct InboundRateLimits
+{
+	std::array<RateLimit, static_cast<size_t>(RateClass::Count)> classes{}; /**< Limits per RateClass; all disabled by default. */
+	OverLimitAction action = OverLimitAction::Skip; /**< Handling of an over-limit frame. */
+	uint32_t closeAfterSkipped = 0;                 /**< With Skip, close the session after this many skipped frames; 0 never. */
+
+	/**
+	 * @brief Limit for one class.
+	 */
+	RateLimit& operator[](RateClass rateClass) { return classes[static_cast<size_t>(rateClass)]; }
+	const RateLimit& operator[](RateClass rateClass) const { return classes[static_cast<size_t>(rateClass)]; }
+
+	/**
+	 * @brief Limits sized for a player client: generous for what the game sends, tight for floods.
+	 */
+	static InboundRateLimits player()
+	{
+		InboundRateLimits limits;
+		limits[RateClass::Control] = { 10.0, 20.0, 16.0 * 1024, 64.0 * 1024 };
+		limits[RateClass::Movement] = { 60.0, 120.0, 16.0 * 1024, 64.0 * 1024 };
+		limits[RateClass::Game] = { 100.0, 200.0, 256.0 * 1024, 512.0 * 1024 };
+		limits.closeAfterSkipped = 1000;
+		return limits;
+	}
+};
+
+/**
+ * @struct SessionOptions
+ * @brief Per-session I/O configuration.
+ */
+struct SessionOptions
+{
+	ReadMode readMode = ReadMode::Batched;   /**< Receive strategy. */
+	size_t receiveBufferSize = 16 * 1024;   /**< ReceiveBuffer capacity for ReadMode::Batched; larger frames are read into a pooled buffer of their own. */
+	size_t maxBytesPerFlush = 256 * 1024;   /**< Soft cap on bytes gathered into one socket write. */
+	size_t bulkThreshold = 4 * 1024;        /**< PacketLane::Auto packets with larger payloads take the bulk lane. */
+	size_t bulkChunkSize = 16 * 1024;       /**< Payload bytes per bulk frame; one chunk goes out per write, after every critical packet. */
+
+	size_t maxPendingBytes = 1024 * 1024;   /**< Outbound payload bytes queued but not yet written before the session is over budget. */
+	size_t maxPendingPackets = 4096;        /**< Outbound packets queued but not yet written before the session is over budget. */
+	std::chrono::milliseconds overBudgetGrace{ 3000 }; /**< How long a session may stay over budget before it is disconnected. */
+
+	std::chrono::milliseconds handshakeTimeout{ 10000 }; /**< Time to send the first valid frame before the session is closed; 0 disables. */
+
+	SocketOptions socketOptions;            /**< TCP tuning applied to the listener and every accepted socket. */
+
+	std::shared_ptr<PacketCapture> capture; /**< Trace file that receives every decrypted inbound frame; nullptr disables capture. */
+
+	InboundRateLimits inboundLimits;        /**< Per-session inbound rate limits; off unless configured, see InboundRateLimits::player(). */
+};
+
+/**
+ * @struct ServerOptions
+ * @brief Admission control and startup pre-allocation for a Server.
+ */
+struct ServerOptions
+{
+	size_t maxSessions = 50000;          /**< Connections beyond this many live sessions are closed on accept. */
+	size_t maxPendingHandshakes = 1024;  /**< Sessions that have not sent a valid frame yet; more are closed on accept. */
+	double acceptRatePerSecond = 1000.0; /**< Sustained accepts per second; 0 disables the limit. */
+	double acceptBurst = 200.0;          /**< Accepts allowed back to back before the rate applies. */
+	size_t preallocatedSessions = 256;   /**< Sessions allocated at startup, each with a receive buffer of SessionOptions::receiveBufferSize (4 MB in all at the defaults). */
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+/**
+ * @file SessionPool.hpp
+ * @brief Pre-allocated storage for ClientSessions, handed out through std::allocate_shared.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "ClientSession.hpp"
+#include "NetworkMetrics.hpp"
+
+/**
+ * @class SessionPool
+ * @brief Fixed number of session-sized blocks carved from one allocation at startup.
+ *
+ * create() places the shared_ptr control block and the ClientSession in one pooled
+ * block, so accepting a connection does not touch the heap for the session itself.
+ * When the pool is exhausted, or a block would be too small, it falls back to the heap
+ * and counts NetworkMetrics::sessionPoolOverflows. The storage stays alive until the last
+ * session allocated from it is destroyed, even if the pool object goes away first.
+ */
+class SessionPool
+{
+	/** Alignment of every block; ClientSession holds cache-line aligned members. */
+	static constexpr size_t blockAlignment = std::max(alignof(std::max_align_t), alignof(ClientSession));
+
+	/**
+	 * @struct Slab
+	 * @brief The blocks and their free list, shared by every allocator copy.
+	 */
+	struct Slab
+	{
+		Slab(size_t count, size_t blockSize)
+			: blockSize(blockSize),
+			capacity(count),
+			storage(static_cast<std::byte*>(::operator new(count * blockSize, std::align_val_t(blockAlignment))))
+		{
+			free.reserve(count);
+			for(size_t i = count; i-- > 0;)
+				free.push_back(storage.get() + i * blockSize);
+		}
+
+		bool owns(const void* pointer) const
+		{
+			const auto* address = static_cast<const std::byte*>(pointer);
+			return address >= storage.get() && address < storage.get() + capacity * blockSize;
+		}
+
+		struct StorageDeleter
+		{
+			void operator()(std::byte* storage) const { ::operator delete(storage, std::align_val_t(blockAlignment)); }
+		};
+
+		const size_t blockSize;                /**< Bytes per block, a multiple of blockAlignment. */
+		const size_t capacity;                 /**< Number of blocks in storage. */
+		std::unique_ptr<std::byte, StorageDeleter> storage; /**< All blocks, contiguous. */
+		std::vector<std::byte*> free;          /**< Blocks ready for reuse. */
+		mutable std::mutex mutex;              /**< Guards free. */
+	};
+
+public:
+	/**
+	 * @class Allocator
+	 * @brief Standard allocator serving single objects from the slab.
+	 */
+	template <typename T>
+	class Allocator
+	{
+	public:
+		using value_type = T;
+
+		explicit Allocator(std::shared_ptr<Slab> slab) : slab_(std::move(slab)) {}
+
+		template <typename U>
+		Allocator(const Allocator<U>& other) : slab_(other.slab_) {}
+
+		T* allocate(size_t n)
+		{
+			if(n == 1 && sizeof(T) <= slab_->blockSize && alignof(T) <= blockAlignment)
+			{
+				std::lock_guard<std::mutex> lock(slab_->mutex);
+				if(!slab_->free.empty())
+				{
+					std::byte* block = slab_->free.back();
+					slab_->free.pop_back();
+					return reinterpret_cast<T*>(block);
+				}
+			}
+			NetworkMetrics::bump(NetworkMetrics::shared().sessionPoolOverflows);
+			return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+		}
+
+		void deallocate(T* pointer, size_t)
+		{
+			if(slab_->owns(pointer))
+			{
+				std::lock_guard<std::mutex> lock(slab_->mutex);
+				slab_->free.push_back(reinterpret_cast<std::byte*>(pointer));
+				return;
+			}
+			::operator delete(pointer, std::align_val_t(alignof(T)));
+		}
+
+		template <typename U>
+		bool operator==(const Allocator<U>& other) const { return slab_ == other.slab_; }
+
+	private:
+		template <typename U>
+		friend class Allocator;
+
+		std::shared_ptr<Slab> slab_; /**< Keeps the storage alive while allocations are outstanding. */
+	};
+
+	/**
+	 * @brief Reserve storage for a number of sessions.
+	 * @param count Sessions to pre-allocate.
+	 */
+	explicit SessionPool(size_t count)
+		: slab_(std::make_shared<Slab>(count, blockSize))
+	{
+	}
+
+	/**
+	 * @brief Construct a session in a pooled block.
+	 * @param args ClientSession constructor arguments.
+	 */
+	template <typename... Args>
+	std::shared_ptr<ClientSession> create(Args&&... args)
+	{
+		return std::allocate_shared<ClientSession>(Allocator<ClientSession>(slab_), std::forward<Args>(args)...);
+	}
+
+	/**
+	 * @brief Blocks currently free.
+	 */
+	size_t available() const
+	{
+		std::lock_guard<std::mutex> lock(slab_->mutex);
+		return slab_->free.size();
+	}
+
+	/**
+	 * @brief Blocks reserved at construction.
+	 */
+	size_t capacity() const { return slab_->capacity; }
+
+private:
+	/** Room for a ClientSession plus the allocate_shared control block (counts, allocator and alignment padding), rounded to blockAlignment. */
+	static constexpr size_t blockSize =
+		(sizeof(ClientSession) + 2 * std::max<size_t>(blockAlignment, 64) + blockAlignment - 1) / blockAlignment * blockAlignment;
+
+	std::shared_ptr<Slab> slab_; /**< Shared with every allocator handed to allocate_shared. */
+};
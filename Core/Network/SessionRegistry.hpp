@@ -0,0 +1,350 @@
+#pragma once
+
+/**
+ * @file SessionRegistry.hpp
+ * @brief Generational slot map of live ClientSessions addressed by SessionHandle.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include "SessionHandle.hpp"
+
+class ClientSession;
+
+/**
+ * @class SessionRegistry
+ * @brief Owns the sessions of a Server and resolves SessionHandles to them.
+ *
+ * A sparse slot array maps handles to positions in dense, contiguous arrays, so lookup
+ * by handle is two array reads and broadcasting walks one packed vector. Removal swaps
+ * the last dense entry into the hole. Player ids are indexed by an open-addressing table
+ * sized up front, so steady-state connects and disconnects allocate nothing.
+ *
+ * Sessions register on accept and remove themselves on close; the game loop only
+ * holds handles and resolves them when it needs to reply.
+ */
+class SessionRegistry
+{
+public:
+	/**
+	 * @brief Create a registry.
+	 * @param expectedSessions Capacity to reserve (see reserve()).
+	 */
+	explicit SessionRegistry(size_t expectedSessions = 1024)
+	{
+		reserve(expectedSessions);
+	}
+
+	/**
+	 * @brief Pre-size every table for a number of concurrent sessions.
+	 * @param count Expected peak session count.
+	 */
+	void reserve(size_t count)
+	{
+		std::unique_lock lock(mutex_);
+		slots_.reserve(count);
+		freeSlots_.reserve(count);
+		dense_.reserve(count);
+		denseToSlot_.reserve(count);
+		denseToPlayer_.reserve(count);
+		players_.reserve(count);
+	}
+
+	/**
+	 * @brief Store a session and issue its handle.
+	 * @param session Session to keep alive until remove().
+	 */
+	SessionHandle add(std::shared_ptr<ClientSession> session)
+	{
+		std::unique_lock lock(mutex_);
+
+		uint32_t index;
+		if(!freeSlots_.empty())
+		{
+			index = freeSlots_.back();
+			freeSlots_.pop_back();
+		}
+		else
+		{
+			index = static_cast<uint32_t>(slots_.size());
+			slots_.emplace_back();
+		}
+
+		slots_[index].dense = static_cast<uint32_t>(dense_.size());
+		dense_.push_back(std::move(session));
+		denseToSlot_.push_back(index);
+		denseToPlayer_.push_back(noPlayer);
+		return SessionHandle{ index, slots_[index].generation };
+	}
+
+	/**
+	 * @brief Drop a session; outstanding handles to it stop resolving.
+	 * @return False if the handle was stale.
+	 */
+	bool remove(SessionHandle handle)
+	{
+		std::shared_ptr<ClientSession> released;
+		{
+			std::unique_lock lock(mutex_);
+			Slot* slot = resolve(handle);
+			if(!slot) return false;
+
+			const uint32_t dense = slot->dense;
+			if(denseToPlayer_[dense] != noPlayer) players_.erase(denseToPlayer_[dense]);
+
+			// Swap the last dense entry into the hole
+			const uint32_t last = static_cast<uint32_t>(dense_.size() - 1);
+			released = std::move(dense_[dense]);
+			if(dense != last)
+			{
+				dense_[dense] = std::move(dense_[last]);
+				denseToSlot_[dense] = denseToSlot_[last];
+				denseToPlayer_[dense] = denseToPlayer_[last];
+				slots_[denseToSlot_[dense]].dense = dense;
+			}
+			dense_.pop_back();
+			denseToSlot_.pop_back();
+			denseToPlayer_.pop_back();
+
+			slot->dense = noDense;
+			if(++slot->generation == 0) slot->generation = 1;
+			freeSlots_.push_back(handle.index);
+		}
+		// released is destroyed here, outside the lock
+		return true;
+	}
+
+	/**
+	 * @brief Associate a player id with a live session.
+	 *
+	 * An id held by another live session is only taken over with replace set; that session
+	 * then loses its binding. Callers binding untrusted ids (e.g. from LOGIN) leave it unset.
+	 *
+	 * @param handle Session to bind.
+	 * @param playerId Player id, e.g. HardMovePacket::playerId after login.
+	 * @param replace Take the id from another live session that holds it.
+	 * @return False if the handle was stale or the id belongs to another live session.
+	 */
+	bool bindPlayer(SessionHandle handle, uint32_t playerId, bool replace = false)
+	{
+		std::unique_lock lock(mutex_);
+		Slot* slot = resolve(handle);
+		if(!slot || playerId == noPlayer) return false;
+
+		const Slot* other = nullptr;
+		if(const SessionHandle* previous = players_.find(playerId))
+		{
+			other = resolve(*previous);
+			if(other == slot) return true;
+			if(other && !replace) return false;
+		}
+		if(other) denseToPlayer_[other->dense] = noPlayer;
+
+		uint32_t& current = denseToPlayer_[slot->dense];
+		if(current != noPlayer) players_.erase(current);
+
+		current = playerId;
+		players_.insertOrAssign(playerId, handle);
+		return true;
+	}
+
+	/**
+	 * @brief Look up the session bound to a player id.
+	 * @return The handle, or an invalid handle if none.
+	 */
+	SessionHandle findByPlayer(uint32_t playerId) const
+	{
+		std::shared_lock lock(mutex_);
+		const SessionHandle* handle = players_.find(playerId);
+		return handle ? *handle : SessionHandle{};
+	}
+
+	/**
+	 * @brief Get a strong reference to a live session.
+	 * @return nullptr if the handle is stale.
+	 */
+	std::shared_ptr<ClientSession> find(SessionHandle handle) const
+	{
+		std::shared_lock lock(mutex_);
+		const Slot* slot = resolve(handle);
+		return slot ? dense_[slot->dense] : nullptr;
+	}
+
+	/**
+	 * @brief Call fn(ClientSession&) if the handle is live, without touching its refcount.
+	 * @return True if fn ran.
+	 */
+	template <typename Fn>
+	bool visit(SessionHandle handle, Fn&& fn) const
+	{
+		std::shared_lock lock(mutex_);
+		const Slot* slot = resolve(handle);
+		if(!slot) return false;
+		fn(*dense_[slot->dense]);
+		return true;
+	}
+
+	/**
+	 * @brief Call fn(ClientSession&) for every live session, in dense (unspecified) order.
+	 *
+	 * Holds a shared lock: fn must not add or remove sessions synchronously.
+	 */
+	template <typename Fn>
+	void forEach(Fn&& fn) const
+	{
+		std::shared_lock lock(mutex_);
+		for(const auto& session : dense_)
+			fn(*session);
+	}
+
+	/**
+	 * @brief Number of registered sessions.
+	 */
+	size_t size() const
+	{
+		std::shared_lock lock(mutex_);
+		return dense_.size();
+	}
+
+private:
+	static constexpr uint32_t noDense = UINT32_MAX;  /**< Slot is free. */
+	static constexpr uint32_t noPlayer = UINT32_MAX; /**< Session has no player bound. */
+
+	/**
+	 * @struct Slot
+	 * @brief Sparse entry; generation advances every time it is freed.
+	 */
+	struct Slot
+	{
+		uint32_t dense = noDense; /**< Position in the dense arrays. */
+		uint32_t generation = 1;  /**< Current generation; never 0. */
+	};
+
+	/**
+	 * @class PlayerIndex
+	 * @brief Open-addressing playerId -> SessionHandle table with linear probing.
+	 *
+	 * Deletion shifts followers back instead of leaving tombstones, so probe lengths stay
+	 * short under constant churn. Capacity only changes in reserve() or when the load
+	 * factor would pass one half.
+	 */
+	class PlayerIndex
+	{
+	public:
+		void reserve(size_t count)
+		{
+			size_t capacity = 16;
+			while(capacity < count * 2) capacity <<= 1;
+			if(capacity > entries_.size()) rehash(capacity);
+		}
+
+		const SessionHandle* find(uint32_t key) const
+		{
+			if(entries_.empty()) return nullptr;
+			for(size_t i = bucket(key);; i = (i + 1) & mask())
+			{
+				const Entry& entry = entries_[i];
+				if(entry.key == noPlayer) return nullptr;
+				if(entry.key == key) return &entry.handle;
+			}
+		}
+
+		void insertOrAssign(uint32_t key, SessionHandle handle)
+		{
+			if((size_ + 1) * 2 > entries_.size()) rehash(std::max<size_t>(16, entries_.size() * 2));
+			for(size_t i = bucket(key);; i = (i + 1) & mask())
+			{
+				Entry& entry = entries_[i];
+				if(entry.key == key)
+				{
+					entry.handle = handle;
+					return;
+				}
+				if(entry.key == noPlayer)
+				{
+					entry = Entry{ key, handle };
+					++size_;
+					return;
+				}
+			}
+		}
+
+		void erase(uint32_t key)
+		{
+			if(entries_.empty()) return;
+			size_t hole = bucket(key);
+			while(entries_[hole].key != key)
+			{
+				if(entries_[hole].key == noPlayer) return;
+				hole = (hole + 1) & mask();
+			}
+
+			// Backward-shift deletion: pull later entries of the cluster into the hole
+			for(size_t next = (hole + 1) & mask(); entries_[next].key != noPlayer; next = (next + 1) & mask())
+			{
+				const size_t home = bucket(entries_[next].key);
+				const bool movable = ((next - home) & mask()) >= ((next - hole) & mask());
+				if(movable)
+				{
+					entries_[hole] = entries_[next];
+					hole = next;
+				}
+			}
+			entries_[hole] = Entry{};
+			--size_;
+		}
+
+	private:
+		struct Entry
+		{
+			uint32_t key = noPlayer;
+			SessionHandle handle;
+		};
+
+		size_t mask() const { return entries_.size() - 1; }
+
+		size_t bucket(uint32_t key) const
+		{
+			// Fibonacci hashing spreads sequential ids across the table
+			return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> 32) & mask();
+		}
+
+		void rehash(size_t capacity)
+		{
+			std::vector<Entry> old = std::move(entries_);
+			entries_.assign(capacity, Entry{});
+			size_ = 0;
+			for(const Entry& entry : old)
+			{
+				if(entry.key != noPlayer) insertOrAssign(entry.key, entry.handle);
+			}
+		}
+
+		std::vector<Entry> entries_; /**< Power-of-two table; key noPlayer marks an empty bucket. */
+		size_t size_ = 0;            /**< Occupied buckets. */
+	};
+
+	Slot* resolve(SessionHandle handle)
+	{
+		if(handle.index >= slots_.size()) return nullptr;
+		Slot& slot = slots_[handle.index];
+		return slot.generation == handle.generation && slot.dense != noDense ? &slot : nullptr;
+	}
+
+	const Slot* resolve(SessionHandle handle) const
+	{
+		return const_cast<SessionRegistry*>(this)->resolve(handle);
+	}
+
+	mutable std::shared_mutex mutex_;                  /**< Guards all members. */
+	std::vector<Slot> slots_;                          /**< Sparse slots indexed by SessionHandle::index. */
+	std::vector<uint32_t> freeSlots_;                  /**< Slot indices ready for reuse. */
+	std::vector<std::shared_ptr<ClientSession>> dense_; /**< Live sessions, contiguous. */
+	std::vector<uint32_t> denseToSlot_;                /**< Slot index of each dense entry. */
+	std::vector<uint32_t> denseToPlayer_;              /**< Bound player id of each dense entry. */
+	PlayerIndex players_;                              /**< playerId -> handle. */
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+/**
+ * @file SocketOptions.hpp
+ * @brief Typed TCP socket tuning applied to accepted and connected sockets.
+ */
+
+#include "AsioConfig.hpp"
+#include <chrono>
+
+/**
+ * @struct SocketOptions
+ * @brief Per-listener or per-client TCP tuning.
+ *
+ * A default-constructed SocketOptions only disables Nagle's algorithm and leaves
+ * everything else at the system defaults. Options the platform does not support
+ * (TCP_QUICKACK and SO_BUSY_POLL are Linux only) are skipped. Options the kernel refuses,
+ * for example SO_BUSY_POLL without CAP_NET_ADMIN, are reported by apply() but do not
+ * stop the others from being applied.
+ *
+ * Give each Server its own profile through SessionOptions::socketOptions, e.g.
+ * lowLatency() on the game port and bulk() on a patch or asset port.
+ */
+struct SocketOptions
+{
+	bool noDelay = true;          /**< TCP_NODELAY: send small frames immediately instead of waiting for ACKs. */
+	int sendBufferBytes = 0;      /**< SO_SNDBUF; 0 keeps the system default. */
+	int receiveBufferBytes = 0;   /**< SO_RCVBUF; 0 keeps the system default. Also set on the listener so the TCP window scale matches. */
+	bool quickAck = false;        /**< TCP_QUICKACK: ACK immediately instead of delaying; re-armed after every read because the kernel clears it. */
+	int busyPollMicros = 0;       /**< SO_BUSY_POLL: spin on the device queue this long before sleeping in a read; 0 disables. */
+
+	bool keepAlive = false;                  /**< SO_KEEPALIVE: probe idle connections to detect dead peers. */
+	std::chrono::seconds keepAliveIdle{ 0 };     /**< TCP_KEEPIDLE: idle time before the first probe; 0 keeps the system default. */
+	std::chrono::seconds keepAliveInterval{ 0 }; /**< TCP_KEEPINTVL: time between probes; 0 keeps the system default. */
+	int keepAliveProbes = 0;                 /**< TCP_KEEPCNT: unanswered probes before the connection is dropped; 0 keeps the system default. */
+
+	/**
+	 * @brief Profile for interactive game traffic: no Nagle, immediate ACKs, busy polling and fast dead-peer detection.
+	 */
+	static SocketOptions lowLatency()
+	{
+		SocketOptions options;
+		options.quickAck = true;
+		options.busyPollMicros = 50;
+		options.keepAlive = true;
+		options.keepAliveIdle = std::chrono::seconds(30);
+		options.keepAliveInterval = std::chrono::seconds(5);
+		options.keepAliveProbes = 3;
+		return options;
+	}
+
+	/**
+	 * @brief Profile for large transfers: Nagle on and 4 MB kernel buffers for throughput.
+	 */
+	static SocketOptions bulk()
+	{
+		SocketOptions options;
+		options.noDelay = false;
+		options.sendBufferBytes = 4 * 1024 * 1024;
+		options.receiveBufferBytes = 4 * 1024 * 1024;
+		options.keepAlive = true;
+		return options;
+	}
+
+	/**
+	 * @brief Apply every configured option to a connected socket.
+	 * @return First error, if any; the remaining options are still applied.
+	 */
+	asio::error_code apply(asio::ip::tcp::socket& socket) const
+	{
+		asio::error_code result;
+		const auto set = [&](const auto& option)
+		{
+			asio::error_code ec;
+			socket.set_option(option, ec);
+			if(ec && !result) result = ec;
+		};
+
+		set(asio::ip::tcp::no_delay(noDelay));
+		if(sendBufferBytes > 0) set(asio::socket_base::send_buffer_size(sendBufferBytes));
+		if(receiveBufferBytes > 0) set(asio::socket_base::receive_buffer_size(receiveBufferBytes));
+#if defined(TCP_QUICKACK)
+		if(quickAck) set(asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_QUICKACK>(true));
+#endif
+#if defined(SO_BUSY_POLL)
+		if(busyPollMicros > 0) set(asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>(busyPollMicros));
+#endif
+		if(keepAlive)
+		{
+			set(asio::socket_base::keep_alive(true));
+#if defined(TCP_KEEPIDLE)
+			if(keepAliveIdle.count() > 0) set(asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPIDLE>(static_cast<int>(keepAliveIdle.count())));
+#endif
+#if defined(TCP_KEEPINTVL)
+			if(keepAliveInterval.count() > 0) set(asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPINTVL>(static_cast<int>(keepAliveInterval.count())));
+#endif
+#if defined(TCP_KEEPCNT)
+			if(keepAliveProbes > 0) set(asio::detail::socket_option::integer<IPPROTO_TCP, TCP_KEEPCNT>(keepAliveProbes));
+#endif
+		}
+		return result;
+	}
+
+	/**
+	 * @brief Apply the options accepted sockets inherit from their listener: the kernel buffer sizes.
+	 * @return First error, if any.
+	 */
+	asio::error_code applyToListener(asio::ip::tcp::acceptor& acceptor) const
+	{
+		asio::error_code result;
+		asio::error_code ec;
+		if(sendBufferBytes > 0) acceptor.set_option(asio::socket_base::send_buffer_size(sendBufferBytes), ec);
+		if(ec) result = ec;
+		if(receiveBufferBytes > 0) acceptor.set_option(asio::socket_base::receive_buffer_size(receiveBufferBytes), ec);
+		if(ec && !result) result = ec;
+		return result;
+	}
+
+	/**
+	 * @brief Re-enable TCP_QUICKACK after a read; no-op unless quickAck is set.
+	 */
+	void rearmQuickAck(asio::ip::tcp::socket& socket) const
+	{
+#if defined(TCP_QUICKACK)
+		if(!quickAck) return;
+		asio::error_code ignored;
+		socket.set_option(asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_QUICKACK>(true), ignored);
+#else
+		(void)socket;
+#endif
+	}
+};
@@ -8,6 +8,7 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <utility>
 
 /**
  * @class ThreadSafeQueue
@@ -31,6 +32,19 @@ public:
 		cond_.notify_one();
 	}
 
+	/**
+	 * @brief Move an item into the queue.
+	 * @param item The item to add.
+	 */
+	void push(T&& item)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			queue_.push(std::move(item));
+		}
+		cond_.notify_one();
+	}
+
 	/**
 	 * @brief Pop an item from the queue.
 	 * @param item The popped item will be stored here.
@@ -40,7 +54,7 @@ public:
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
 		if(queue_.empty()) return false;
-		item = queue_.front();
+		item = std::move(queue_.front());
 		queue_.pop();
 		return true;
 	}
@@ -53,7 +67,7 @@ public:
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
 		cond_.wait(lock, [this] { return !queue_.empty(); });
-		item = queue_.front();
+		item = std::move(queue_.front());
 		queue_.pop();
 	}
 
@@ -0,0 +1,83 @@
+#pragma once
+
+/**
+ * @file TokenBucket.hpp
+ * @brief Token bucket rate limiter.
+ */
+
+#include <algorithm>
+#include <chrono>
+
+/**
+ * @class TokenBucket
+ * @brief Allows bursts up to a capacity and a sustained rate of tokens per second.
+ *
+ * Tokens are refilled lazily from the elapsed time whenever the bucket is queried, so
+ * an idle bucket costs nothing. Not thread-safe; guard it or keep it on one strand.
+ */
+class TokenBucket
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Create a full bucket.
+	 * @param ratePerSecond Sustained refill rate; 0 or less disables limiting.
+	 * @param burst Maximum tokens stored.
+	 */
+	TokenBucket(double ratePerSecond, double burst)
+		: rate_(ratePerSecond),
+		capacity_(std::max(burst, 1.0)),
+		tokens_(capacity_),
+		last_(Clock::now())
+	{
+	}
+
+	/**
+	 * @brief True if the bucket limits anything at all.
+	 */
+	bool enabled() const { return rate_ > 0.0; }
+
+	/**
+	 * @brief Take tokens if enough are available.
+	 * @param count Tokens to take.
+	 * @param now Current time.
+	 * @return False if the bucket holds fewer than count tokens; nothing is taken then.
+	 */
+	bool tryTake(double count = 1.0, Clock::time_point now = Clock::now())
+	{
+		if(!enabled()) return true;
+		refill(now);
+		if(tokens_ < count) return false;
+		tokens_ -= count;
+		return true;
+	}
+
+	/**
+	 * @brief Time until count tokens will be available.
+	 * @param count Tokens wanted.
+	 * @param now Current time.
+	 */
+	Clock::duration timeUntil(double count = 1.0, Clock::time_point now = Clock::now())
+	{
+		if(!enabled()) return Clock::duration::zero();
+		refill(now);
+		if(tokens_ >= count) return Clock::duration::zero();
+		const std::chrono::duration<double> wait((count - tokens_) / rate_);
+		return std::chrono::ceil<Clock::duration>(wait);
+	}
+
+private:
+	void refill(Clock::time_point now)
+	{
+		if(now <= last_) return;
+		const std::chrono::duration<double> elapsed = now - last_;
+		tokens_ = std::min(capacity_, tokens_ + elapsed.count() * rate_);
+		last_ = now;
+	}
+
+	double rate_;            /**< Tokens added per second. */
+	double capacity_;        /**< Maximum stored tokens. */
+	double tokens_;          /**< Currently available tokens. */
+	Clock::time_point last_; /**< Time of the last refill. */
+};
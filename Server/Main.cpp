@@ -2,9 +2,170 @@
 //
 
 #include "pch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <Core/Network/InterestGrid.hpp>
+#include <Core/Network/PacketCapture.hpp>
+#include <Core/Network/Server.hpp>
 
-int main()
+namespace
 {
-    std::cout << "Hello World!\n";
+	/**
+	 * @struct ServerArgs
+	 * @brief Command line of the server.
+	 */
+	struct ServerArgs
+	{
+		uint16_t port = 7777;                                                /**< Listen port. */
+		size_t ioThreads = std::max(1u, std::thread::hardware_concurrency()); /**< Network threads. */
+		CipherMode cipher = CipherMode::Aes256Gcm;                          /**< Packet cipher. */
+		std::string secret = "reforged-dev";                                /**< Secret the session keys are derived from. */
+		double traceSeconds = 0.0;                                          /**< Interval between PacketTrace dumps; 0 leaves tracing off. */
+		std::string capturePath;                                            /**< Trace file for inbound frames, replayable with Tools/Replay; empty disables capture. */
+		bool rateLimit = false;                                             /**< Apply InboundRateLimits::player() to every session. */
+	};
+
+	bool parseArgs(int argc, char* argv[], ServerArgs& args)
+	{
+		for(int i = 1; i + 1 < argc; i += 2)
+		{
+			const std::string name = argv[i];
+			const std::string value = argv[i + 1];
+			if(name == "--port") args.port = static_cast<uint16_t>(std::stoul(value));
+			else if(name == "--threads") args.ioThreads = std::max<size_t>(1, std::stoul(value));
+			else if(name == "--cipher") { if(!parseCipher(value, args.cipher)) return false; }
+			else if(name == "--secret") args.secret = value;
+			else if(name == "--trace") args.traceSeconds = std::stod(value);
+			else if(name == "--capture") args.capturePath = value;
+			else if(name == "--rate-limit")
+			{
+				if(value != "player" && value != "off") return false;
+				args.rateLimit = value == "player";
+			}
+			else return false;
+		}
+		return argc % 2 == 1;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	ServerArgs args;
+	if(!parseArgs(argc, argv, args))
+	{
+		std::cerr << "Usage: Server [--port N] [--threads N] [--cipher cbc|gcm|chacha] [--secret S] [--trace S] [--capture FILE] [--rate-limit player|off]\n";
+		return 1;
+	}
+
+	// The server runs until killed, so the capture is flushed periodically rather than on exit
+	SessionOptions sessionOptions;
+	if(args.rateLimit) sessionOptions.inboundLimits = InboundRateLimits::player();
+	if(!args.capturePath.empty())
+	{
+		sessionOptions.capture = std::make_shared<PacketCapture>(args.capturePath);
+		std::thread([capture = sessionOptions.capture]()
+					{
+						for(;;)
+						{
+							std::this_thread::sleep_for(std::chrono::seconds(1));
+							capture->flush();
+						}
+					}).detach();
+	}
+
+	IoContextPool pool(args.ioThreads);
+	ThreadSafeQueue<GameEvent> events;
+	Server server(pool, args.port, Crypto::fromSecret(args.secret, args.cipher), events, sessionOptions);
+	pool.run();
+	// Per-opcode stage latencies, dumped to stderr while the server runs
+	if(args.traceSeconds > 0.0)
+	{
+		PacketTrace::shared().enable();
+		std::thread([interval = std::chrono::duration<double>(args.traceSeconds)]()
+					{
+						for(;;)
+						{
+							std::this_thread::sleep_for(interval);
+							PacketTrace::shared().dump(std::cerr);
+						}
+					}).detach();
+	}
+	std::cout << "Listening on port " << args.port << " with " << args.ioThreads << " io threads (" << ioBackendName() << ")" << std::endl;
+
+	// Minimal game loop: answer PINGs, remember which player owns each session and relay MOVEs to nearby players
+	InterestGrid interest;
+	std::vector<InterestChange> changes;
+	std::unordered_map<uint64_t, HardMovePacket> lastMoves;
+	const auto send = [&](SessionHandle target, const Packet& packet)
+	{
+		server.sessions().visit(target, [&](ClientSession& session) { session.sendPacket(packet); });
+	};
+	GameEvent event;
+	for(;;)
+	{
+		events.waitPop(event);
+		PacketTrace::Scope trace(event.opcode, event.trace);
+		switch(event.opcode)
+		{
+		case PING:
+			if(auto session = server.sessions().find(event.session))
+				session->sendPacket(Packet(std::vector<uint8_t>(event.payload.begin(), event.payload.end()), PING));
+			break;
+
+		case LOGIN:
+			if(event.payload.size() >= sizeof(uint32_t))
+			{
+				uint32_t playerId = 0;
+				std::memcpy(&playerId, event.payload.data(), sizeof(playerId));
+				// Another live session already holding the id keeps it
+				if(!server.sessions().bindPlayer(event.session, playerId))
+					std::cerr << "Rejected LOGIN of player " << playerId << ": id in use or session gone\n";
+			}
+			break;
+
+		case MOVE:
+		{
+			HardMovePacket move;
+			std::memcpy(&move, event.payload.data(), sizeof(move));
+			const uint32_t playerId = move.playerId; // Packed member: copy before binding a reference
+			lastMoves[event.session.value()] = move;
+
+			changes.clear();
+			interest.move(event.session, move.x, move.z, changes);
+			// Observers that just came into range get this MOVE below; the mover needs their last position
+			for(const InterestChange& change : changes)
+			{
+				if(!change.entered || change.observer != event.session) continue;
+				const auto last = lastMoves.find(change.subject.value());
+				if(last == lastMoves.end()) continue;
+				Packet position(last->second, sizeof(last->second));
+				send(event.session, position.setDroppable(last->second.playerId));
+			}
+
+			// Serialized once; every observer's copy shares the payload. A newer MOVE of the same
+			// player replaces it in a slow observer's queue, and it is dropped while that one is over budget
+			Packet update(move, sizeof(move));
+			update.share();
+			update.setDroppable(playerId);
+			interest.forEachObserver(event.session, [&](SessionHandle observer) { send(observer, update); });
+			break;
+		}
+
+		case SESSION_CLOSED:
+			// Last event of the session: it leaves every view
+			changes.clear();
+			interest.remove(event.session, changes);
+			lastMoves.erase(event.session.value());
+			break;
+
+		default:
+			break;
+		}
+	}
 }
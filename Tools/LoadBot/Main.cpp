@@ -0,0 +1,299 @@
+// Main.cpp : Headless load generator that drives a Server with simulated players.
+//
+// Each bot is a Core Client that connects, sends LOGIN and then a mix of MOVE and PING
+// packets at a fixed rate. The server echoes PINGs, which gives round-trip latency, and
+// relays each MOVE to the bots near the mover; --spread sets how far apart bots start.
+//
+// Builds with the LoadBot project on Windows. On Linux, with asio and OpenSSL installed,
+// run this from the repository root:
+//   g++ -std=c++20 -O2 -I. Tools/LoadBot/Main.cpp -o loadbot -lssl -lcrypto -pthread
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Core/Network/Client.hpp>
+#include <Core/Network/IoContextPool.hpp>
+#include <Core/Network/LatencyHistogram.hpp>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @struct BotArgs
+	 * @brief Command line of the load generator.
+	 */
+	struct BotArgs
+	{
+		std::string host = "127.0.0.1";                                      /**< Server address. */
+		uint16_t port = 7777;                                                /**< Server port. */
+		size_t bots = 1000;                                                  /**< Simulated players. */
+		size_t ioThreads = std::max(1u, std::thread::hardware_concurrency()); /**< Network threads. */
+		double durationSeconds = 30.0;                                       /**< Run time after the ramp-up. */
+		double moveRate = 10.0;                                              /**< MOVE packets per bot per second. */
+		double pingRate = 1.0;                                               /**< PING packets per bot per second. */
+		double rampRate = 1000.0;                                            /**< New connections per second. */
+		double reportSeconds = 1.0;                                          /**< Interval between progress lines. */
+		double spread = 0.0;                                                 /**< Edge of the square bots start in, centred on the origin; 0 starts all at the origin. */
+		CipherMode cipher = CipherMode::Aes256Gcm;                          /**< Packet cipher; must match the server. */
+		std::string secret = "reforged-dev";                                /**< Secret the keys are derived from. */
+	};
+
+	/**
+	 * @struct BotStats
+	 * @brief Counters shared by all bots.
+	 */
+	struct BotStats
+	{
+		std::atomic<uint64_t> connected{ 0 };      /**< Successful connects. */
+		std::atomic<uint64_t> connectFailures{ 0 }; /**< Failed connects. */
+		std::atomic<uint64_t> packetsSent{ 0 };    /**< Packets queued to the server. */
+		std::atomic<uint64_t> bytesSent{ 0 };      /**< Payload bytes queued to the server. */
+		std::atomic<uint64_t> pongs{ 0 };          /**< PING echoes received. */
+		std::atomic<uint64_t> movesReceived{ 0 };  /**< MOVEs of other bots relayed by the server. */
+		LatencyHistogram rtt;                      /**< PING round trips. */
+	};
+
+	/**
+	 * @class Bot
+	 * @brief One simulated player: a Client plus a timer that paces its traffic.
+	 */
+	class Bot : public std::enable_shared_from_this<Bot>
+	{
+	public:
+		Bot(asio::io_context& ioContext, uint32_t playerId, const BotArgs& args, const Crypto& crypto,
+			PacketDispatcher<Client>& dispatcher, BotStats& stats, const std::atomic<bool>& stopping)
+			: client_(std::make_shared<Client>(ioContext, crypto, dispatcher)),
+			timer_(ioContext),
+			playerId_(playerId),
+			args_(args),
+			stats_(stats),
+			stopping_(stopping),
+			random_(playerId)
+		{
+			std::uniform_real_distribution<float> start(static_cast<float>(-args.spread / 2.0), static_cast<float>(args.spread / 2.0));
+			x_ = start(random_);
+			z_ = start(random_);
+
+			const double rate = args.moveRate + args.pingRate;
+			interval_ = rate > 0.0
+				? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate))
+				: Clock::duration::zero();
+		}
+
+		void start(const tcp::resolver::results_type& endpoints)
+		{
+			client_->connect(endpoints, [this, self = shared_from_this()](std::error_code ec)
+							 {
+								 if(ec)
+								 {
+									 stats_.connectFailures.fetch_add(1, std::memory_order_relaxed);
+									 return;
+								 }
+								 stats_.connected.fetch_add(1, std::memory_order_relaxed);
+
+								 std::vector<uint8_t> login(sizeof(playerId_));
+								 std::memcpy(login.data(), &playerId_, sizeof(playerId_));
+								 send(Packet(login, LOGIN));
+
+								 if(interval_ == Clock::duration::zero()) return;
+								 // Spread the first tick so bots do not send in lockstep
+								 std::uniform_int_distribution<Clock::rep> offset(0, interval_.count());
+								 timer_.expires_after(Clock::duration(offset(random_)));
+								 tick();
+							 });
+		}
+
+		void stop()
+		{
+			asio::post(timer_.get_executor(), [self = shared_from_this()]() { self->timer_.cancel(); });
+			client_->disconnect();
+		}
+
+		bool connected() const { return client_->connected(); }
+
+	private:
+		void tick()
+		{
+			timer_.async_wait([this, self = shared_from_this()](std::error_code ec)
+							  {
+								  if(ec || stopping_ || !client_->connected()) return;
+
+								  std::uniform_real_distribution<double> pick(0.0, args_.moveRate + args_.pingRate);
+								  if(pick(random_) < args_.pingRate) sendPing();
+								  else sendMove();
+
+								  timer_.expires_at(timer_.expiry() + interval_);
+								  tick();
+							  });
+		}
+
+		void sendPing()
+		{
+			const uint64_t sentAt = static_cast<uint64_t>(Clock::now().time_since_epoch().count());
+			std::vector<uint8_t> payload(sizeof(sentAt));
+			std::memcpy(payload.data(), &sentAt, sizeof(sentAt));
+			send(Packet(payload, PING));
+		}
+
+		void sendMove()
+		{
+			std::uniform_real_distribution<float> step(-1.0f, 1.0f);
+			HardMovePacket move;
+			move.playerId = playerId_;
+			move.x = x_ += step(random_);
+			move.y = 0.0f;
+			move.z = z_ += step(random_);
+			send(Packet(move, sizeof(move)));
+		}
+
+		void send(Packet packet)
+		{
+			stats_.packetsSent.fetch_add(1, std::memory_order_relaxed);
+			stats_.bytesSent.fetch_add(packet.body().size(), std::memory_order_relaxed);
+			client_->sendPacket(std::move(packet));
+		}
+
+		std::shared_ptr<Client> client_;  /**< Connection to the server. */
+		asio::steady_timer timer_;        /**< Paces MOVE/PING sends. */
+		uint32_t playerId_;               /**< Sent in LOGIN and MOVE. */
+		const BotArgs& args_;             /**< Rates and mix. */
+		BotStats& stats_;                 /**< Shared counters. */
+		const std::atomic<bool>& stopping_; /**< Set when the run ends. */
+		std::mt19937 random_;             /**< Per-bot randomness, touched only by the timer handler. */
+		Clock::duration interval_{};      /**< Time between sends. */
+		float x_ = 0.0f;                  /**< Random-walk position. */
+		float z_ = 0.0f;                  /**< Random-walk position. */
+	};
+
+	bool parseArgs(int argc, char* argv[], BotArgs& args)
+	{
+		for(int i = 1; i + 1 < argc; i += 2)
+		{
+			const std::string name = argv[i];
+			const std::string value = argv[i + 1];
+			if(name == "--host") args.host = value;
+			else if(name == "--port") args.port = static_cast<uint16_t>(std::stoul(value));
+			else if(name == "--bots") args.bots = std::stoul(value);
+			else if(name == "--threads") args.ioThreads = std::max<size_t>(1, std::stoul(value));
+			else if(name == "--duration") args.durationSeconds = std::stod(value);
+			else if(name == "--move-rate") args.moveRate = std::stod(value);
+			else if(name == "--ping-rate") args.pingRate = std::stod(value);
+			else if(name == "--ramp") args.rampRate = std::stod(value);
+			else if(name == "--report") args.reportSeconds = std::max(0.1, std::stod(value));
+			else if(name == "--spread") args.spread = std::max(0.0, std::stod(value));
+			else if(name == "--cipher") { if(!parseCipher(value, args.cipher)) return false; }
+			else if(name == "--secret") args.secret = value;
+			else return false;
+		}
+		return argc % 2 == 1;
+	}
+
+	void printLatency(const char* label, const std::vector<uint64_t>& counts)
+	{
+		const auto micros = [&](double quantile) { return static_cast<double>(LatencyHistogram::percentile(counts, quantile)) / 1000.0; };
+		std::cout << label << " p50 " << micros(0.50) << "us p99 " << micros(0.99) << "us p999 " << micros(0.999) << "us";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	BotArgs args;
+	if(!parseArgs(argc, argv, args))
+	{
+		std::cerr << "Usage: LoadBot [--host H] [--port N] [--bots N] [--threads N] [--duration S]\n"
+			"               [--move-rate R] [--ping-rate R] [--ramp R] [--report S] [--spread W]\n"
+			"               [--cipher cbc|gcm|chacha] [--secret S]\n";
+		return 1;
+	}
+
+	IoContextPool pool(args.ioThreads);
+	pool.run();
+
+	const Crypto crypto = Crypto::fromSecret(args.secret, args.cipher);
+	BotStats stats;
+	std::atomic<bool> stopping{ false };
+
+	PacketDispatcher<Client> dispatcher;
+	dispatcher.registerHandler(PING, [&stats](Client&, std::span<const uint8_t> payload)
+							   {
+								   if(payload.size() < sizeof(uint64_t)) return;
+								   uint64_t sentAt = 0;
+								   std::memcpy(&sentAt, payload.data(), sizeof(sentAt));
+								   const uint64_t now = static_cast<uint64_t>(Clock::now().time_since_epoch().count());
+								   const auto rtt = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::duration(now - sentAt));
+								   stats.rtt.record(static_cast<uint64_t>(rtt.count()));
+								   stats.pongs.fetch_add(1, std::memory_order_relaxed);
+							   });
+	dispatcher.registerHandler(MOVE, [&stats](Client&, std::span<const uint8_t>)
+							   {
+								   stats.movesReceived.fetch_add(1, std::memory_order_relaxed);
+							   });
+
+	tcp::resolver resolver(pool.at(0));
+	const auto endpoints = resolver.resolve(args.host, std::to_string(args.port));
+
+	// Ramp up at the configured connect rate
+	std::vector<std::shared_ptr<Bot>> bots;
+	bots.reserve(args.bots);
+	const auto rampStart = Clock::now();
+	for(size_t i = 0; i < args.bots; ++i)
+	{
+		if(args.rampRate > 0.0)
+			std::this_thread::sleep_until(rampStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(i / args.rampRate)));
+		auto& bot = bots.emplace_back(std::make_shared<Bot>(pool.next(), static_cast<uint32_t>(i + 1), args, crypto, dispatcher, stats, stopping));
+		bot->start(endpoints);
+	}
+
+	std::cout << std::fixed << std::setprecision(1);
+	const auto runStart = Clock::now();
+	const auto runEnd = runStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(args.durationSeconds));
+	const auto reportInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(args.reportSeconds));
+	uint64_t lastSent = stats.packetsSent, lastPongs = stats.pongs, lastMoves = stats.movesReceived;
+	auto lastReport = runStart;
+
+	while(Clock::now() < runEnd)
+	{
+		std::this_thread::sleep_until(std::min(lastReport + reportInterval, runEnd));
+		const auto now = Clock::now();
+		const double seconds = std::chrono::duration<double>(now - lastReport).count();
+		const uint64_t sent = stats.packetsSent, pongs = stats.pongs, moves = stats.movesReceived;
+		const size_t live = static_cast<size_t>(std::count_if(bots.begin(), bots.end(), [](const auto& bot) { return bot->connected(); }));
+
+		std::cout << "[" << std::chrono::duration<double>(now - runStart).count() << "s] live " << live
+			<< " sent/s " << static_cast<double>(sent - lastSent) / seconds
+			<< " pong/s " << static_cast<double>(pongs - lastPongs) / seconds
+			<< " relayed moves/s " << static_cast<double>(moves - lastMoves) / seconds << " ";
+		printLatency("rtt", stats.rtt.snapshot());
+		std::cout << "\n";
+
+		lastSent = sent;
+		lastPongs = pongs;
+		lastMoves = moves;
+		lastReport = now;
+	}
+
+	stopping = true;
+	for(auto& bot : bots) bot->stop();
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	pool.stop();
+
+	const double seconds = std::chrono::duration<double>(runEnd - runStart).count();
+	std::cout << "\nbots " << args.bots << " connected " << stats.connected << " failed " << stats.connectFailures << "\n"
+		<< "sent " << stats.packetsSent << " packets (" << static_cast<double>(stats.packetsSent) / seconds << "/s, "
+		<< static_cast<double>(stats.bytesSent) / seconds / 1024.0 << " KiB/s payload)\n"
+		<< "pongs " << stats.pongs << "\n"
+		<< "relayed moves " << stats.movesReceived << " (" << static_cast<double>(stats.movesReceived) / seconds << "/s)\n";
+	printLatency("rtt", stats.rtt.snapshot());
+	std::cout << "\n";
+	return 0;
+}
@@ -0,0 +1,184 @@
+// Main.cpp : Replays a PacketCapture trace into a game loop, without sockets.
+//
+// A server started with --capture writes every decrypted inbound frame to a trace file.
+// This tool reads such a trace back as GameEvents. It either pushes them into a
+// ThreadSafeQueue drained by a game-loop thread, as the server does, or dispatches them
+// inline on the replay thread. Events go out at the original pace, a multiple of it or as
+// fast as possible, so production load can be reproduced on a dev box and game-loop
+// changes benchmarked against real traffic.
+//
+// The game loop here decodes every packet the dev server understands and keeps the last
+// position per player, which stands in for the real simulation.
+//
+// Builds with the Replay project on Windows. On Linux, with asio and OpenSSL installed,
+// run this from the repository root:
+//   g++ -std=c++20 -O2 -I. Tools/Replay/Main.cpp -o replay -pthread
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <Core/Network/HardPacket.hpp>
+#include <Core/Network/LatencyHistogram.hpp>
+#include <Core/Network/PacketDispatcher.hpp>
+#include <Core/Network/PacketReplay.hpp>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @struct ReplayArgs
+	 * @brief Command line of the replay tool.
+	 */
+	struct ReplayArgs
+	{
+		std::string trace;          /**< Trace file written by PacketCapture. */
+		double speed = 1.0;         /**< Multiple of the captured pace; 0 replays as fast as possible. */
+		std::string mode = "queue"; /**< queue: through ThreadSafeQueue and a game-loop thread; inline: dispatch on the replay thread. */
+	};
+
+	/**
+	 * @struct World
+	 * @brief Minimal game state the replayed events act on.
+	 */
+	struct World
+	{
+		SessionHandle session;                             /**< Sender of the current event. */
+		std::unordered_map<uint64_t, uint32_t> players;    /**< Player bound to each session by LOGIN. */
+		std::unordered_map<uint32_t, HardMovePacket> positions; /**< Last MOVE per player. */
+		uint64_t pings = 0;                                /**< PINGs handled. */
+	};
+
+	void onLogin(World& world, std::span<const uint8_t> payload)
+	{
+		if(payload.size() < sizeof(uint32_t)) return;
+		uint32_t playerId = 0;
+		std::memcpy(&playerId, payload.data(), sizeof(playerId));
+		world.players[world.session.value()] = playerId;
+	}
+
+	void onMove(World& world, std::span<const uint8_t> payload)
+	{
+		// Traces come from disk and may be truncated or corrupt
+		if(payload.size() < sizeof(HardMovePacket)) return;
+		HardMovePacket move;
+		std::memcpy(&move, payload.data(), sizeof(move));
+		const uint32_t playerId = move.playerId; // Packed member: copy before binding a reference
+		world.positions[playerId] = move;
+	}
+
+	void onPing(World& world, std::span<const uint8_t>)
+	{
+		++world.pings;
+	}
+
+	void onSessionClosed(World& world, std::span<const uint8_t>)
+	{
+		world.players.erase(world.session.value());
+	}
+
+	using WorldDispatcher = PacketDispatcher<World, PacketRoute<LOGIN, &onLogin>, PacketRoute<MOVE, &onMove>, PacketRoute<PING, &onPing>,
+		PacketRoute<SESSION_CLOSED, &onSessionClosed>>;
+
+	/**
+	 * @brief Dispatch one event and time the handler.
+	 */
+	void handle(const WorldDispatcher& dispatcher, World& world, LatencyHistogram& handleTime, const GameEvent& event)
+	{
+		const auto start = Clock::now();
+		world.session = event.session;
+		dispatcher.dispatch(world, event.opcode, event.payload.span());
+		handleTime.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+	}
+
+	bool parseArgs(int argc, char* argv[], ReplayArgs& args)
+	{
+		for(int i = 1; i + 1 < argc; i += 2)
+		{
+			const std::string name = argv[i];
+			const std::string value = argv[i + 1];
+			if(name == "--trace") args.trace = value;
+			else if(name == "--speed")
+			{
+				try { args.speed = std::stod(value); }
+				catch(const std::invalid_argument&) { return false; }
+				catch(const std::out_of_range&) { return false; }
+			}
+			else if(name == "--mode") args.mode = value;
+			else return false;
+		}
+		return argc % 2 == 1 && !args.trace.empty() && args.speed >= 0.0 && (args.mode == "queue" || args.mode == "inline");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	ReplayArgs args;
+	if(!parseArgs(argc, argv, args))
+	{
+		std::cerr << "Usage: Replay --trace FILE [--speed X] [--mode queue|inline]\n"
+			"  --speed 1 replays at the captured pace, 0 as fast as possible.\n";
+		return 1;
+	}
+
+	try
+	{
+		PacketReplay replay(args.trace);
+		const WorldDispatcher dispatcher;
+		World world;
+		LatencyHistogram handleTime;
+		const auto start = Clock::now();
+		ReplayStats stats;
+
+		if(args.mode == "inline")
+		{
+			stats = replay.run([&](GameEvent&& event) { handle(dispatcher, world, handleTime, event); }, args.speed);
+		}
+		else
+		{
+			// Same shape as the server: the replay thread stands in for the io threads
+			ThreadSafeQueue<GameEvent> events;
+			std::atomic<bool> done{ false };
+			std::thread gameLoop([&]()
+								 {
+									 GameEvent event;
+									 for(;;)
+									 {
+										 // Read done first: an empty queue after the last push means everything was handled
+										 const bool finished = done;
+										 if(events.pop(event)) handle(dispatcher, world, handleTime, event);
+										 else if(finished) break;
+										 else std::this_thread::yield();
+									 }
+								 });
+			stats = replay.run(events, args.speed);
+			done = true;
+			gameLoop.join();
+		}
+
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		const auto counts = handleTime.snapshot();
+		const auto micros = [&](double quantile) { return static_cast<double>(LatencyHistogram::percentile(counts, quantile)) / 1000.0; };
+		std::cout << "events " << stats.events
+			<< " captured " << std::chrono::duration<double>(stats.captured).count() << "s"
+			<< " replayed " << seconds << "s"
+			<< " (" << static_cast<uint64_t>(static_cast<double>(stats.events) / seconds) << " events/s)"
+			<< " max lag " << std::chrono::duration<double, std::milli>(stats.maxLag).count() << "ms\n"
+			<< "handle p50 " << micros(0.50) << "us p99 " << micros(0.99) << "us p999 " << micros(0.999) << "us\n"
+			<< "players " << world.players.size() << " positions " << world.positions.size() << " pings " << world.pings << "\n";
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}